@@ -3,39 +3,66 @@
 #include "app.hpp"
 
 #include <fstream>
-#include <iostream>
 #include <set>
+#include <unordered_set>
+#include <algorithm>
+#include <chrono>
+
+#include "state_cache.hpp"
+#include "../discord/model_sax.hpp"
 
 namespace discord {
 
-    App::App() : m_running(false) {}
+    App::App() : m_events(*this), m_running(false) {}
 
     App::~App() {
         if (m_gateway) m_gateway->close();
+        if (m_db) m_db->close();
         if (m_ui) m_ui->shutdown();
     }
 
     bool App::init(const std::string& config_path) {
+        m_start_time = std::chrono::steady_clock::now();
         load_config(config_path);
         if (m_config.token.empty()) {
-            std::cerr << "Token not found in config.json" << std::endl;
+            LOG_ERROR("App", "Token not found in config.json");
             return false;
         }
 
         m_ui = std::make_unique<UI>();
         if (!m_ui->init()) {
-            std::cerr << "Failed to initialize UI" << std::endl;
+            LOG_ERROR("App", "Failed to initialize UI");
             return false;
         }
 
         m_rest = std::make_unique<Rest>(m_config.token);
+        m_wake_hook = [] { UI::wake(); };
+
+        m_state.history_per_channel = m_config.history_per_channel;
+        m_state.history_budget_bytes = m_config.history_budget_mb * 1024 * 1024;
+
+        // Paint from the last session while the gateway connects; READY
+        // reconciles whatever changed in between
+        if (!m_config.cache_path.empty()) {
+            auto t0 = std::chrono::steady_clock::now();
+            m_cache_loaded = load_state_cache(m_config.cache_path, m_state);
+            if (m_cache_loaded) {
+                LOG_INFO("App", "Loaded cache: ", m_state.guilds.size(), " guilds, ", m_state.messages.size(), " channels in ",
+                         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(), " ms");
+            }
+        }
+
+        if (!m_config.message_db_path.empty()) {
+            m_db = std::make_unique<MessageDb>();
+            if (!m_db->open(m_config.message_db_path)) m_db.reset();
+        }
 
-        static std::set<std::string> requested_icons;
-        m_ui->on_load_icon = [this](const std::string& guild_id, const std::string& icon_hash) {
+        static std::set<Snowflake> requested_icons;
+        m_ui->on_load_icon = [this](Snowflake guild_id, const std::string& icon_hash) {
             if (requested_icons.count(guild_id)) return;
             requested_icons.insert(guild_id);
 
-            std::string url = "https://cdn.discordapp.com/icons/" + guild_id + "/" + icon_hash + ".png?size=64";
+            std::string url = "https://cdn.discordapp.com/icons/" + guild_id.str() + "/" + icon_hash + ".png?size=64";
             
             std::thread([this, guild_id, url]() {
                 CURL* curl = curl_easy_init();
@@ -66,55 +93,42 @@ namespace discord {
         };
         
         // UI Callbacks
-        m_ui->on_channel_selected = [this](const std::string& channel_id) {
-            std::string current_cid;
-            {
-                std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
-                m_state.current_channel_id = channel_id;
-                m_state.channel_error = ""; // Clear old error
-                m_state.reply_msg_id = ""; // Clear old reply
-                current_cid = channel_id;
-            }
+        m_ui->on_channel_selected = [this](Snowflake channel_id) {
+            m_state.current_channel_id = channel_id;
+            m_state.channel_error = ""; // Clear old error
+            m_state.reply_msg_id = {}; // Clear old reply
+            m_state.touch_channel(channel_id);
 
             // Fetch messages for this channel via REST
-            m_rest->get_messages(current_cid, [this, current_cid](bool success, const json& data) {
-                post_task([this, current_cid, success, data]() {
-                    std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
-                    if (success) {
-                        std::vector<Message> msgs;
-                        if (data.is_array()) {
-                            for (auto it = data.rbegin(); it != data.rend(); ++it) {
-                                msgs.push_back(it->get<Message>());
-                            }
-                        }
-                        m_state.messages[current_cid] = msgs;
-                        
-                        // Send ACK for the last message
-                        if (!msgs.empty()) {
-                            m_rest->ack_message(current_cid, msgs.back().id);
-                        }
-                    } else {
-                        m_state.channel_error = "No Access";
-                    }
-                });
-            });
+            request_history(channel_id, true);
         };
 
-        m_ui->on_reply_selected = [this](const std::string& msg_id, const std::string& username, const std::string& content, const std::string& guild_id) {
-            std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
+        m_ui->on_load_older = [this](Snowflake channel_id, Snowflake before) {
+            request_older(channel_id, before);
+        };
+
+        m_ui->on_search = [this](const std::string& text, const std::string& author, bool this_channel) {
+            search(text, author, this_channel ? m_state.current_channel_id : Snowflake{});
+        };
+
+        m_ui->on_search_result_selected = [this](Snowflake guild_id, Snowflake channel_id) {
+            m_state.current_guild_id = guild_id;
+            m_ui->on_channel_selected(channel_id);
+        };
+
+        m_ui->on_reply_selected = [this](Snowflake msg_id, const std::string& username, const std::string& content, Snowflake guild_id) {
             m_state.reply_msg_id = msg_id;
             m_state.reply_username = username;
             m_state.reply_content = content;
             m_state.reply_guild_id = guild_id;
         };
 
-        m_ui->on_guild_selected = [this](const std::string& guild_id) {
-            std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
+        m_ui->on_guild_selected = [this](Snowflake guild_id) {
             m_state.current_guild_id = guild_id;
-            m_state.current_channel_id = ""; // Reset channel
+            m_state.current_channel_id = {}; // Reset channel
             m_state.channel_error = "";
-            m_state.reply_msg_id = "";
-            m_state.reply_guild_id = "";
+            m_state.reply_msg_id = {};
+            m_state.reply_guild_id = {};
             
             // Auto select first text channel
             Guild* g = m_state.get_guild(guild_id);
@@ -122,23 +136,8 @@ namespace discord {
                 for (const auto& c : g->channels) {
                     if (c.type == 0) {
                         m_state.current_channel_id = c.id;
-                        std::string cid = c.id;
-                        m_rest->get_messages(cid, [this, cid](bool success, const json& data) {
-                            post_task([this, cid, success, data]() {
-                                std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
-                                if (success) {
-                                    std::vector<Message> msgs;
-                                    if (data.is_array()) {
-                                        for (auto it = data.rbegin(); it != data.rend(); ++it) {
-                                            msgs.push_back(it->get<Message>());
-                                        }
-                                    }
-                                    m_state.messages[cid] = msgs;
-                                } else {
-                                    m_state.channel_error = "No Access";
-                                }
-                            });
-                        });
+                        m_state.touch_channel(c.id);
+                        request_history(c.id, false);
                         break;
                     }
                 }
@@ -161,38 +160,33 @@ namespace discord {
                         // Remove newline
                         result.erase(result.find_last_not_of(" \n\r\t") + 1);
                         post_task([this, result]() {
-                            std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
                             m_state.attached_file_path = result;
-                        });
+                        }, TaskPriority::Interactive);
                     }
                 }
             }).detach();
         };
 
-        m_ui->on_send_message = [this](const std::string& content, const std::string& reply_id, const std::string& file_path) {
-            std::string cid, gid;
-            {
-                std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
-                cid = m_state.current_channel_id;
-                gid = m_state.reply_guild_id;
-                // Clear state after sending
-                m_state.reply_msg_id = "";
-                m_state.reply_username = "";
-                m_state.reply_content = "";
-                m_state.reply_guild_id = "";
-                m_state.attached_file_path = "";
-            }
+        m_ui->on_send_message = [this](const std::string& content, Snowflake reply_id, const std::string& file_path) {
+            Snowflake cid = m_state.current_channel_id;
+            Snowflake gid = m_state.reply_guild_id;
+            // Clear state after sending
+            m_state.reply_msg_id = {};
+            m_state.reply_username = "";
+            m_state.reply_content = "";
+            m_state.reply_guild_id = {};
+            m_state.attached_file_path = "";
             if (!cid.empty()) {
                 m_rest->send_message(cid, content, gid, reply_id, file_path, [cid](bool s, const json& d){
                     if (!s) {
-                        std::cerr << "[App] Failed to send message to " << cid << ". Response: " << d.dump() << std::endl;
+                        LOG_ERROR("App", "Failed to send message to ", cid, ". Response: ", d.dump());
                     }
                 });
             }
         };
 
-        static std::set<std::string> requested_attachments;
-        m_ui->on_load_attachment = [this](const std::string& att_id, const std::string& url) {
+        static std::set<Snowflake> requested_attachments;
+        m_ui->on_load_attachment = [this](Snowflake att_id, const std::string& url) {
             if (requested_attachments.count(att_id)) return;
             requested_attachments.insert(att_id);
 
@@ -225,101 +219,290 @@ namespace discord {
         };
 
         m_ui->on_clear_attachment = [this]() {
-            std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
             m_state.attached_file_path = "";
         };
 
+        m_events.on<&App::on_ready>(GatewayEvent::Ready);
+        m_events.on<&App::on_guild_create>(GatewayEvent::GuildCreate);
+        m_events.on<&App::on_message_create>(GatewayEvent::MessageCreate);
+        m_events.on<&App::on_message_update>(GatewayEvent::MessageUpdate);
+        m_events.on<&App::on_message_delete>(GatewayEvent::MessageDelete);
+        m_events.on<&App::on_message_delete_bulk>(GatewayEvent::MessageDeleteBulk);
+        m_events.on<&App::on_message_ack>(GatewayEvent::MessageAck);
+        m_events.on<&App::on_channel_create>(GatewayEvent::ChannelCreate);
+        m_events.on<&App::on_channel_update>(GatewayEvent::ChannelUpdate);
+        m_events.on<&App::on_channel_delete>(GatewayEvent::ChannelDelete);
+
         m_gateway = std::make_unique<Gateway>([this](const std::string& event, const json& data) {
-            // Gateway callback runs on gateway thread
-            // We copy data to ensure lifetime
-            json d = data;
-            post_task([this, event, d]() {
-                handle_event(event, d);
-            });
+            // Gateway callback runs on gateway thread. Models are built here;
+            // the main thread only applies the finished objects.
+            if (Task task = m_events.build(event, data)) {
+                post_task(std::move(task));
+            }
         });
 
         m_gateway->connect(m_config.token);
 
+        // Refresh the channel restored from the cache
+        if (!m_state.current_channel_id.empty()) request_history(m_state.current_channel_id, false);
+
         return true;
     }
 
     void App::run() {
         m_running = true;
+        int frames_pending = FRAMES_AFTER_EVENT;
+        auto last_render = std::chrono::steady_clock::now();
         while (m_running && !m_ui->should_close()) {
-            process_main_thread_tasks();
-            
+            // Sleep until input, a posted task or the refresh interval
+            // unless frames are still owed for an earlier event
+            double interval = m_ui->is_animating() ? ANIMATION_INTERVAL_S : IDLE_REFRESH_S;
+            if (frames_pending > 0) m_ui->poll_events();
+            else m_ui->wait_events(interval);
+
+            auto frame_start = std::chrono::steady_clock::now();
+            auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(TASK_BUDGET_MS));
+            TaskRunStats tasks = process_main_thread_tasks(frame_start + budget);
+            // A backlog keeps the loop polling until it has been worked off
+            if (m_ui->take_input() || tasks.ran > 0 || tasks.backlog > 0) frames_pending = FRAMES_AFTER_EVENT;
+
+            bool refresh_due = frame_start - last_render >= std::chrono::duration<double>(interval);
+            if (frames_pending == 0 && !refresh_due) continue;
+            if (frames_pending > 0) --frames_pending;
+
             m_ui->new_frame();
-            
-            {
-                std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
-                m_ui->render(m_state);
+            m_ui->render(m_state);
+
+            auto now = std::chrono::steady_clock::now();
+            last_render = now;
+            if (!m_first_content_logged && !m_state.guilds.empty()) {
+                m_first_content_logged = true;
+                LOG_INFO("App", "First meaningful frame after ", std::chrono::duration<double, std::milli>(now - m_start_time).count(),
+                         " ms (", m_cache_loaded ? "warm cache" : "cold start", ")");
             }
+            m_frame_stats.record(std::chrono::duration<double, std::milli>(now - frame_start).count());
+            m_task_stats.record(tasks.ms);
+            m_peak_backlog = std::max(m_peak_backlog, tasks.backlog);
+            if (m_frame_stats.full()) {
+                [[maybe_unused]] FrameStats::Summary s = m_frame_stats.summary();
+                [[maybe_unused]] FrameStats::Summary t = m_task_stats.summary();
+                LOG_INFO("App", "Frame times over ", s.frames, " frames: p50 ", s.p50, " ms, p95 ", s.p95, " ms, p99 ", s.p99,
+                         " ms, max ", s.max, " ms; tasks p95 ", t.p95, " ms, max ", t.max, " ms, peak backlog ", m_peak_backlog);
+                m_frame_stats.reset();
+                m_task_stats.reset();
+                m_peak_backlog = 0;
+            }
+        }
+
+        if (!m_config.cache_path.empty() && !m_state.guilds.empty()) {
+            save_state_cache(m_config.cache_path, m_state, m_config.cache_messages_per_channel);
         }
     }
 
-    void App::handle_event(const std::string& event, const json& data) {
-        std::lock_guard<std::recursive_mutex> lock(m_state_mutex);
-        std::cout << "[App] Event received: " << event << std::endl;
-        
-        try {
-                            if (event == "READY") {
-                                std::cout << "[App] READY! Connected as " << data["user"]["username"] << std::endl;
-                                if (data.contains("guilds")) {
-                                    std::cout << "[App] READY contains " << data["guilds"].size() << " guilds. Parsing..." << std::endl;
-                                    for (const auto& g_json : data["guilds"]) {
-                                        try {
-                                            Guild g = g_json.get<Guild>();
-                                            m_state.guilds.push_back(g);
-                                        } catch (...) {
-                                            // Some guilds in READY might be partial/unavailable
-                                        }
-                                    }
-                                    // Build map
-                                    m_state.guild_map.clear();
-                                    for (auto& existing : m_state.guilds) {
-                                        m_state.guild_map[existing.id] = &existing;
-                                    }
-                                }
-                                                    } else if (event == "MESSAGE_CREATE") {
-                                                        try {
-                                                            Message m = data.get<Message>();
-                                                            m_state.messages[m.channel_id].push_back(m);
-                                                            
-                                                            // Auto-ACK if this is the current channel
-                                                            if (m.channel_id == m_state.current_channel_id) {
-                                                                m_rest->ack_message(m.channel_id, m.id);
-                                                            }
-                                                        } catch (const std::exception& e) {                                                std::cerr << "[App] Error parsing Message: " << e.what() << std::endl;
-                                            }
-                                        } else if (event == "GUILD_CREATE") {
-                                            try {
-                                                Guild g = data.get<Guild>();
-                                                // std::cout << "[App] Real-time Guild Joined/Loaded: " << g.name << std::endl;
-                                                bool found = false;
-                                                for (auto& eg : m_state.guilds) {
-                                                    if (eg.id == g.id) {
-                                                        eg = g;
-                                                        found = true;
-                                                        break;
-                                                    }
-                                                }
-                                                if (!found) {
-                                                    m_state.guilds.push_back(g);
-                                                }
-                                                
-                                                m_state.guild_map.clear();
-                                                for (auto& existing : m_state.guilds) {
-                                                    m_state.guild_map[existing.id] = &existing;
-                                                }
-                                            } catch (const std::exception& e) {
-                                                std::cerr << "[App] Error parsing Guild: " << e.what() << std::endl;
-                                            }
-                                        }
-                                    } catch (const std::exception& e) {
-            std::cerr << "[App] Error processing event " << event << ": " << e.what() << std::endl;
+    void App::on_ready(ReadyEvent&& ready) {
+        LOG_INFO("App", "READY! Connected as ", ready.user.username, " with ", ready.guilds.size(), " guilds");
+
+        // Reconcile with anything loaded from the cache: guilds left while
+        // offline go away, unavailable stubs keep the cached copy until
+        // their GUILD_CREATE arrives, everything else is replaced.
+        std::unordered_set<Snowflake> present;
+        for (const auto& g : ready.guilds) present.insert(g.id);
+        std::vector<Snowflake> gone;
+        for (const auto& g : m_state.guilds) {
+            if (!present.count(g->id)) gone.push_back(g->id);
+        }
+        for (Snowflake id : gone) m_state.remove_guild(id);
+
+        m_state.guilds.reserve(m_state.guilds.size() + ready.guilds.size());
+        for (auto& g : ready.guilds) {
+            if (g.unavailable && m_state.get_guild(g.id)) continue;
+            m_state.upsert_guild(std::move(g));
+        }
+
+        m_state.self_id = ready.user.id;
+        if (!ready.read_states.empty()) m_state.set_read_states(ready.read_states);
+    }
+
+    void App::on_guild_create(Guild&& guild) {
+        m_state.upsert_guild(std::move(guild));
+    }
+
+    void App::on_message_create(Message&& message) {
+        if (m_db) {
+            // A synced history's newest message directly precedes this one,
+            // so the stored span grows across it
+            Snowflake older;
+            auto it = m_state.messages.find(message.channel_id);
+            if (it != m_state.messages.end() && it->second.synced() && !it->second.empty() && it->second.back().id < message.id) {
+                older = it->second.back().id;
+            }
+            m_db->put(std::span<const Message>(&message, 1), older);
+        }
+        m_state.add_message(message);
+
+        // Auto-ACK if this is the current channel
+        if (message.channel_id == m_state.current_channel_id) {
+            ack(message.channel_id, message.id);
+        } else if (message.author.valid() && message.author->id == m_state.self_id) {
+            // Sent from another device; the server marks it read
+            m_state.unread.ack(message.channel_id, message.id);
+        } else {
+            m_state.unread.on_message(message.channel_id, message.guild_id, message.id, m_state.mentions_self(message));
         }
     }
 
+    void App::on_message_ack(MessageAckEvent&& read) {
+        m_state.unread.ack(read.channel_id, read.message_id);
+    }
+
+    void App::on_message_update(MessageUpdateEvent&& update) {
+        if (m_db) m_db->update(update);
+        m_state.update_message(update);
+    }
+
+    void App::on_message_delete(MessageDeleteEvent&& deleted) {
+        std::span<const Snowflake> ids(&deleted.id, 1);
+        if (m_db) m_db->erase(deleted.channel_id, ids);
+        m_state.delete_messages(deleted.channel_id, ids);
+    }
+
+    void App::on_message_delete_bulk(MessageDeleteBulkEvent&& deleted) {
+        if (m_db) m_db->erase(deleted.channel_id, deleted.ids);
+        m_state.delete_messages(deleted.channel_id, deleted.ids);
+    }
+
+    void App::on_channel_create(Channel&& channel) {
+        m_state.upsert_channel(std::move(channel));
+    }
+
+    void App::on_channel_update(Channel&& channel) {
+        m_state.upsert_channel(std::move(channel));
+    }
+
+    void App::on_channel_delete(Channel&& channel) {
+        m_state.remove_channel(channel.id);
+    }
+
+    void App::request_history(Snowflake channel_id, bool ack) {
+        // The response is parsed on the request thread; the main thread only
+        // takes ownership of the finished page and stores it.
+        m_rest->get_messages(channel_id, [this, channel_id, ack](bool success, const std::string& body) {
+            std::vector<Message> msgs;
+            bool parsed = success && parse_messages(body, msgs);
+            std::reverse(msgs.begin(), msgs.end()); // API returns newest first
+
+            post_task([this, channel_id, ack, parsed, msgs = std::move(msgs)]() {
+                if (!parsed) {
+                    m_state.channel_error = "No Access";
+                    return;
+                }
+                if (m_db) m_db->put(msgs);
+                m_state.set_history(channel_id, msgs);
+
+                // Send ACK for the last message
+                if (ack && !msgs.empty()) {
+                    this->ack(channel_id, msgs.back().id);
+                }
+            }, TaskPriority::Interactive);
+        });
+    }
+
+    void App::request_older(Snowflake channel_id, Snowflake before) {
+        if (!m_loading_older.insert(channel_id).second) return;
+
+        // Disk reads stay off the main thread like the network ones do
+        std::thread([this, channel_id, before]() {
+            auto local = std::make_shared<std::vector<Message>>();
+            if (m_db) *local = m_db->before(channel_id, before, HISTORY_PAGE_SIZE);
+            if (local->size() >= HISTORY_PAGE_SIZE) {
+                post_task([this, channel_id, local]() {
+                    m_loading_older.erase(channel_id);
+                    m_state.prepend_history(channel_id, *local);
+                }, TaskPriority::Interactive);
+                return;
+            }
+
+            // The local span ran out: fetch what precedes it
+            Snowflake rest_before = local->empty() ? before : local->front().id;
+            m_rest->get_messages(channel_id, [this, channel_id, rest_before, local](bool success, const std::string& body) {
+                std::vector<Message> msgs;
+                bool parsed = success && parse_messages(body, msgs);
+                std::reverse(msgs.begin(), msgs.end()); // API returns newest first
+
+                post_task([this, channel_id, rest_before, local, parsed, msgs = std::move(msgs)]() mutable {
+                    m_loading_older.erase(channel_id);
+                    if (parsed && !msgs.empty() && m_db) m_db->put(msgs, {}, rest_before);
+                    if (!parsed) msgs.clear();
+                    msgs.insert(msgs.end(), std::make_move_iterator(local->begin()), std::make_move_iterator(local->end()));
+                    m_state.prepend_history(channel_id, msgs);
+                }, TaskPriority::Interactive);
+            }, rest_before);
+        }).detach();
+    }
+
+    void App::search(const std::string& text, const std::string& author, Snowflake channel_id) {
+        uint64_t generation = ++m_search_generation;
+        m_state.search_results.clear();
+        m_state.search_total = 0;
+        if (text.empty() && author.empty()) return;
+
+        auto t0 = std::chrono::steady_clock::now();
+        SearchIndex::Result result = m_state.search.search({text, author, channel_id});
+        struct Miss {
+            size_t result;
+            Snowflake channel_id;
+            Snowflake id;
+        };
+        std::vector<Miss> misses;
+        for (const auto& hit : result.hits) {
+            SearchResult r;
+            r.id = hit.id;
+            r.channel_id = hit.channel_id;
+            if (const Channel* c = m_state.get_channel(hit.channel_id)) {
+                r.channel = c->name.str();
+                r.guild_id = c->guild_id;
+            }
+            r.author = hit.author->username.str();
+
+            // The index only has IDs: content comes from the history while it
+            // is cached, else from the message store off the main thread
+            auto h = m_state.messages.find(hit.channel_id);
+            size_t i = h != m_state.messages.end() ? h->second.find(hit.id) : ChannelHistory::npos;
+            if (i != ChannelHistory::npos) {
+                MessageView m = h->second[i];
+                r.content = std::string(m.content);
+                r.timestamp = m.timestamp;
+            } else {
+                misses.push_back({m_state.search_results.size(), hit.channel_id, hit.id});
+            }
+            m_state.search_results.push_back(std::move(r));
+        }
+        m_state.search_total = result.total;
+        m_state.search_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (misses.empty() || !m_db) return;
+
+        std::thread([this, generation, misses = std::move(misses)]() mutable {
+            std::vector<std::optional<Message>> found;
+            found.reserve(misses.size());
+            for (const auto& miss : misses) found.push_back(m_db->get(miss.channel_id, miss.id));
+
+            post_task([this, generation, misses = std::move(misses), found = std::move(found)]() {
+                if (generation != m_search_generation) return; // A newer search replaced the results
+                for (size_t k = 0; k < misses.size(); ++k) {
+                    if (!found[k] || misses[k].result >= m_state.search_results.size()) continue;
+                    SearchResult& r = m_state.search_results[misses[k].result];
+                    r.content = found[k]->content.str();
+                    r.timestamp = found[k]->timestamp;
+                }
+            }, TaskPriority::Interactive);
+        }).detach();
+    }
+
+    void App::ack(Snowflake channel_id, Snowflake message_id) {
+        m_state.unread.ack(channel_id, message_id);
+        m_rest->ack_message(channel_id, message_id);
+    }
+
     void App::load_config(const std::string& path) {
         std::ifstream file(path);
         if (file.is_open()) {
@@ -328,33 +511,61 @@ namespace discord {
                 file >> j;
                 if (j.contains("token")) {
                     m_config.token = j["token"];
-                    std::cout << "[App] Config loaded. Token starts with: " << m_config.token.substr(0, 5) << "..." << std::endl;
+                    LOG_INFO("App", "Config loaded. Token starts with: ", m_config.token.substr(0, 5), "...");
                 }
+                if (j.contains("history_per_channel")) j.at("history_per_channel").get_to(m_config.history_per_channel);
+                if (j.contains("history_budget_mb")) j.at("history_budget_mb").get_to(m_config.history_budget_mb);
+                if (j.contains("cache_path")) j.at("cache_path").get_to(m_config.cache_path);
+                if (j.contains("cache_messages_per_channel")) j.at("cache_messages_per_channel").get_to(m_config.cache_messages_per_channel);
+                if (j.contains("message_db_path")) j.at("message_db_path").get_to(m_config.message_db_path);
             } catch (const std::exception& e) {
-                std::cerr << "[App] Error parsing config: " << e.what() << std::endl;
+                LOG_ERROR("App", "Error parsing config: ", e.what());
             }
         } else {
-            std::cerr << "[App] Config file not found at: " << path << std::endl;
+            LOG_ERROR("App", "Config file not found at: ", path);
         }
     }
 
-    void App::post_task(std::function<void()> task) {
-        std::lock_guard<std::mutex> lock(m_queue_mutex);
-        m_task_queue.push(task);
-    }
-
-    void App::process_main_thread_tasks() {
-        std::vector<std::function<void()>> tasks;
-        {
-            std::lock_guard<std::mutex> lock(m_queue_mutex);
-            while (!m_task_queue.empty()) {
-                tasks.push_back(m_task_queue.front());
-                m_task_queue.pop();
-            }
+    void App::post_task(Task task, TaskPriority priority) {
+        auto& queue = priority == TaskPriority::Interactive ? m_interactive_tasks : m_background_tasks;
+        // Producers are worker threads. If the main thread has fallen a full
+        // ring behind they wait for it instead of growing the queue, backing
+        // off to short sleeps so they don't steal its CPU time.
+        for (int spins = 0; !queue.try_push(std::move(task)); ++spins) {
+            if (spins < 16) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
+        if (m_wake_hook) m_wake_hook();
+    }
 
-        for (auto& task : tasks) {
+    App::TaskRunStats App::process_main_thread_tasks(std::chrono::steady_clock::time_point deadline) {
+        TaskRunStats stats;
+        auto start = std::chrono::steady_clock::now();
+        Task task;
+        auto run = [&] {
             task();
+            task = Task();
+            ++stats.ran;
+        };
+
+        // The user is waiting on these and there are few: run all that are
+        // queued now, deadline or not
+        size_t pending = m_interactive_tasks.size_approx();
+        while (pending-- > 0 && m_interactive_tasks.try_pop(task)) run();
+
+        // Background ingest until the deadline, but at least one task per
+        // frame so a busy frame can't starve it
+        bool first = true;
+        while ((first || std::chrono::steady_clock::now() < deadline) && m_background_tasks.try_pop(task)) {
+            run();
+            first = false;
         }
+
+        // Publish profile changes seen by worker-thread parsers
+        UserStore::global().apply_pending_updates();
+
+        stats.backlog = m_interactive_tasks.size_approx() + m_background_tasks.size_approx();
+        stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return stats;
     }
 }
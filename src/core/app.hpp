@@ -3,57 +3,31 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <mutex>
+#include <unordered_set>
 #include <memory>
-#include <queue>
 #include <functional>
+#include <chrono>
 
-#include "../discord/models.hpp"
+#include "state.hpp"
+#include "task.hpp"
+#include "event_registry.hpp"
+#include "log.hpp"
+#include "message_db.hpp"
+#include "mpsc_ring.hpp"
+#include "frame_stats.hpp"
 #include "../discord/gateway.hpp"
 #include "../discord/rest.hpp"
 #include "../ui/ui.hpp"
 
 namespace discord {
 
-    struct State {
-        std::string current_guild_id;
-        std::string current_channel_id;
-        std::string channel_error; // Error message if channel fails to load
-        
-        // Reply state
-        std::string reply_msg_id;
-        std::string reply_username;
-        std::string reply_content;
-        std::string reply_guild_id;
-        
-        // Attachment state
-        std::string attached_file_path;
-        
-        // Use map for easier lookup by ID
-        std::vector<Guild> guilds; // Vector for ordered display, or map for lookups? UI needs order. Vector is better for UI.
-        std::unordered_map<std::string, Guild*> guild_map; // Helper for fast lookup
-        
-        std::unordered_map<std::string, std::vector<Message>> messages; // channel_id -> messages
-        std::unordered_map<std::string, User> users;
-
-        // Helpers
-        Guild* get_guild(const std::string& id) {
-            if (guild_map.find(id) != guild_map.end()) return guild_map[id];
-            return nullptr;
-        }
-        
-        Channel* get_channel(const std::string& guild_id, const std::string& channel_id) {
-            Guild* g = get_guild(guild_id);
-            if (!g) return nullptr;
-            for (auto& c : g->channels) {
-                if (c.id == channel_id) return &c;
-            }
-            return nullptr;
-        }
-    };
-
     struct Config {
         std::string token;
+        size_t history_per_channel = ChannelHistory::DEFAULT_CAPACITY; // Messages kept per channel
+        size_t history_budget_mb = 64; // Total cached history before cold channels are evicted
+        std::string cache_path = "cache.bin"; // Startup snapshot of State; empty disables it
+        size_t cache_messages_per_channel = 50;
+        std::string message_db_path = "messages.db"; // Local message store for scrollback; empty disables it
     };
 
     class App {
@@ -66,23 +40,81 @@ namespace discord {
 
     private:
         void load_config(const std::string& path);
-        void handle_event(const std::string& event, const json& data);
+
+        // Gateway dispatch handlers, registered in m_events. They run on the
+        // main thread with payloads already parsed on the gateway thread.
+        void on_ready(ReadyEvent&& ready);
+        void on_guild_create(Guild&& guild);
+        void on_message_create(Message&& message);
+        void on_message_update(MessageUpdateEvent&& update);
+        void on_message_delete(MessageDeleteEvent&& deleted);
+        void on_message_delete_bulk(MessageDeleteBulkEvent&& deleted);
+        void on_message_ack(MessageAckEvent&& read);
+        void on_channel_create(Channel&& channel);
+        void on_channel_update(Channel&& channel);
+        void on_channel_delete(Channel&& channel);
+
+        void request_history(Snowflake channel_id, bool ack);
+        // Scrollback: loads the page before `before` from the message DB,
+        // falling back to REST for whatever it doesn't have
+        void request_older(Snowflake channel_id, Snowflake before);
+        // Runs a local search and resolves the hits into m_state.search_results
+        void search(const std::string& text, const std::string& author, Snowflake channel_id);
+        // Marks a message read locally and tells the server
+        void ack(Snowflake channel_id, Snowflake message_id);
         
-        // Thread-safe event queue processing
-        void process_main_thread_tasks();
-        void post_task(std::function<void()> task);
+        struct TaskRunStats {
+            size_t ran = 0;
+            size_t backlog = 0; // Tasks left queued for later frames
+            double ms = 0;
+        };
+
+        // Runs queued tasks: every interactive one, then background tasks
+        // until the deadline. Whatever is left waits for the next frame.
+        TaskRunStats process_main_thread_tasks(std::chrono::steady_clock::time_point deadline);
+        void post_task(Task task, TaskPriority priority = TaskPriority::Background);
 
         Config m_config;
+        // Owned by the main thread. Workers never touch it: they build
+        // models off-thread and post a Task that applies them here.
         State m_state;
-        std::recursive_mutex m_state_mutex;
         
         std::unique_ptr<Gateway> m_gateway;
         std::unique_ptr<Rest> m_rest;
         std::unique_ptr<UI> m_ui;
+        std::unique_ptr<MessageDb> m_db;
+        EventRegistry<App> m_events;
 
-        std::queue<std::function<void()>> m_task_queue;
-        std::mutex m_queue_mutex;
+        static constexpr size_t HISTORY_PAGE_SIZE = 50; // Messages per REST history request
+        std::unordered_set<Snowflake> m_loading_older; // Channels with scrollback in flight
+        uint64_t m_search_generation = 0;              // Drops disk lookups for superseded searches
+
+        // Tasks posted by worker threads for the main thread, one ring per
+        // priority. m_wake_hook, if set, runs after every post so an idle UI
+        // loop can wake up.
+        static constexpr size_t TASK_QUEUE_CAPACITY = 4096;
+        static constexpr double TASK_BUDGET_MS = 6.0; // Main-thread task time per frame
+        MpscRing<Task, TASK_QUEUE_CAPACITY> m_interactive_tasks;
+        MpscRing<Task, TASK_QUEUE_CAPACITY> m_background_tasks;
+        std::function<void()> m_wake_hook;
         bool m_running;
+
+        // The loop only renders when something may have changed: input, a
+        // task that ran, or an active widget. Each event buys a few frames
+        // so ImGui can settle hover and layout state.
+        static constexpr int FRAMES_AFTER_EVENT = 3;
+        static constexpr double IDLE_REFRESH_S = 1.0;      // Keeps time-based labels current
+        static constexpr double ANIMATION_INTERVAL_S = 0.1; // Text cursor blink while typing
+
+        // Startup timing: from init() to the first frame that shows guilds
+        std::chrono::steady_clock::time_point m_start_time;
+        bool m_cache_loaded = false;
+        bool m_first_content_logged = false;
+
+        FrameStats m_frame_stats; // Main-thread time per rendered frame, logged once per window
+        FrameStats m_task_stats;  // Task time per rendered frame
+        size_t m_peak_backlog = 0;
+
     };
 
 }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../discord/snowflake.hpp"
+
+namespace discord {
+
+    // Helpers for the client's on-disk formats (state cache, message
+    // database). Values are stored in native byte order: the files are a
+    // local cache, never exchanged between machines.
+
+    inline uint64_t fnv1a64(const char* data, size_t size) {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // Read-only mapping of a whole file
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string& path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st {};
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    m_data = static_cast<const char*>(p);
+                    m_size = static_cast<size_t>(st.st_size);
+                }
+            }
+            ::close(fd);
+        }
+
+        ~MappedFile() {
+            if (m_data) ::munmap(const_cast<char*>(m_data), m_size);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    struct BinaryWriter {
+        std::string out;
+
+        template <typename T>
+        void pod(const T& v) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+        }
+
+        void id(Snowflake s) { pod(s.value); }
+
+        void str(std::string_view s) {
+            pod(static_cast<uint32_t>(s.size()));
+            out.append(s);
+        }
+    };
+
+    // Bounds-checked cursor over a byte range. Any overrun sets ok = false
+    // and yields zeros, so callers check once at the end.
+    struct BinaryReader {
+        const char* p;
+        const char* end;
+        bool ok = true;
+
+        template <typename T>
+        T pod() {
+            T v{};
+            if (static_cast<size_t>(end - p) < sizeof(T)) {
+                ok = false;
+                p = end;
+                return v;
+            }
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+
+        Snowflake id() { return Snowflake(pod<uint64_t>()); }
+
+        std::string_view str() {
+            uint32_t n = pod<uint32_t>();
+            if (static_cast<size_t>(end - p) < n) {
+                ok = false;
+                p = end;
+                return {};
+            }
+            std::string_view s(p, n);
+            p += n;
+            return s;
+        }
+
+        // Element counts are bounded by the bytes left so a corrupt count
+        // can't trigger a huge allocation
+        uint32_t count(size_t min_element_size) {
+            uint32_t n = pod<uint32_t>();
+            if (n > static_cast<size_t>(end - p) / min_element_size) {
+                ok = false;
+                p = end;
+                return 0;
+            }
+            return n;
+        }
+    };
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <string_view>
+
+#include "log.hpp"
+#include "task.hpp"
+#include "../discord/reflect.hpp"
+
+namespace discord {
+
+    // Gateway dispatch events the client handles, in GATEWAY_EVENT_NAMES order
+    enum class GatewayEvent : uint8_t {
+        Ready,
+        GuildCreate,
+        MessageCreate,
+        MessageUpdate,
+        MessageDelete,
+        MessageDeleteBulk,
+        MessageAck,
+        ChannelCreate,
+        ChannelUpdate,
+        ChannelDelete,
+        Count,
+    };
+
+    inline constexpr std::array<std::string_view, static_cast<size_t>(GatewayEvent::Count)> GATEWAY_EVENT_NAMES = {
+        "READY",
+        "GUILD_CREATE",
+        "MESSAGE_CREATE",
+        "MESSAGE_UPDATE",
+        "MESSAGE_DELETE",
+        "MESSAGE_DELETE_BULK",
+        "MESSAGE_ACK",
+        "CHANNEL_CREATE",
+        "CHANNEL_UPDATE",
+        "CHANNEL_DELETE",
+    };
+
+    // Routes gateway dispatches to typed handlers on Context. A handler is a
+    // member function taking its payload struct by rvalue reference. build()
+    // runs on the gateway thread: it resolves the name through a
+    // compile-time perfect hash, parses the payload there and returns a Task
+    // that hands it to the handler on the main thread. Events without a
+    // handler return an empty Task before anything is parsed.
+    template <typename Context>
+    class EventRegistry {
+    public:
+        explicit EventRegistry(Context& ctx) : m_ctx(ctx) {}
+
+        template <auto Handler>
+        void on(GatewayEvent event) {
+            m_builders[static_cast<size_t>(event)] = &build_task<Handler>;
+        }
+
+        Task build(std::string_view event, const json& data) const {
+            int index = reflect::NameTable<GATEWAY_EVENT_NAMES>::lookup(event);
+            if (index < 0 || !m_builders[index]) return {};
+            try {
+                return m_builders[index](m_ctx, data);
+            } catch (const std::exception& e) {
+                LOG_ERROR("App", "Error parsing ", event, ": ", e.what());
+                return {};
+            }
+        }
+
+    private:
+        using Builder = Task (*)(Context&, const json&);
+
+        template <typename Fn>
+        struct HandlerTraits;
+
+        template <typename Payload>
+        struct HandlerTraits<void (Context::*)(Payload&&)> {
+            using payload = Payload;
+        };
+
+        template <auto Handler>
+        static Task build_task(Context& ctx, const json& data) {
+            using Payload = typename HandlerTraits<decltype(Handler)>::payload;
+            return [&ctx, payload = data.get<Payload>()]() mutable { (ctx.*Handler)(std::move(payload)); };
+        }
+
+        Context& m_ctx;
+        std::array<Builder, static_cast<size_t>(GatewayEvent::Count)> m_builders{};
+    };
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace discord {
+
+    // Rolling window of frame durations for spotting main-thread stalls.
+    // Percentiles are computed on demand from a copy of the window, so
+    // recording a frame is a single store.
+    class FrameStats {
+    public:
+        static constexpr size_t WINDOW = 1024;
+
+        struct Summary {
+            size_t frames = 0;
+            double p50 = 0, p95 = 0, p99 = 0, max = 0; // Milliseconds
+        };
+
+        void record(double ms) {
+            m_samples[m_next] = ms;
+            m_next = (m_next + 1) % WINDOW;
+            if (m_count < WINDOW) ++m_count;
+        }
+
+        size_t size() const { return m_count; }
+        bool full() const { return m_count == WINDOW; }
+        void reset() { m_count = 0; m_next = 0; }
+
+        Summary summary() const {
+            Summary s;
+            s.frames = m_count;
+            if (m_count == 0) return s;
+
+            std::array<double, WINDOW> sorted;
+            std::copy_n(m_samples.begin(), m_count, sorted.begin());
+            std::sort(sorted.begin(), sorted.begin() + m_count);
+            auto at = [&](double p) { return sorted[static_cast<size_t>(p * (m_count - 1))]; };
+            s.p50 = at(0.50);
+            s.p95 = at(0.95);
+            s.p99 = at(0.99);
+            s.max = sorted[m_count - 1];
+            return s;
+        }
+
+    private:
+        std::array<double, WINDOW> m_samples{};
+        size_t m_next = 0;
+        size_t m_count = 0;
+    };
+
+}
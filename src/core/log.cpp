@@ -0,0 +1,119 @@
+#include "log.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+
+#include "mpsc_ring.hpp"
+
+namespace discord::logging {
+
+    namespace {
+
+        const char* level_name(Level level) {
+            switch (level) {
+            case Level::Debug: return "DEBUG";
+            case Level::Info: return "INFO ";
+            case Level::Warn: return "WARN ";
+            case Level::Error: return "ERROR";
+            }
+            return "?    ";
+        }
+
+        // Background writer. Producers push into the ring and bump m_signal;
+        // the writer drains the ring, formats each line and flushes once per
+        // batch, then sleeps on m_signal until more records arrive.
+        class Writer {
+        public:
+            static constexpr size_t QUEUE_CAPACITY = 1024;
+
+            Writer() : m_thread([this] { run(); }) {}
+
+            void submit(Record&& r) {
+                if (m_stopped.load(std::memory_order_relaxed) || !m_queue.try_push(std::move(r))) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                m_signal.fetch_add(1, std::memory_order_release);
+                m_signal.notify_one();
+            }
+
+            void stop() {
+                if (m_stopped.exchange(true)) return;
+                m_signal.fetch_add(1, std::memory_order_release);
+                m_signal.notify_one();
+                m_thread.join();
+            }
+
+        private:
+            void run() {
+                for (;;) {
+                    uint32_t seen = m_signal.load(std::memory_order_acquire);
+                    drain();
+                    if (m_stopped.load(std::memory_order_acquire)) {
+                        drain();
+                        return;
+                    }
+                    m_signal.wait(seen, std::memory_order_acquire);
+                }
+            }
+
+            void drain() {
+                bool wrote_out = false;
+                bool wrote_err = false;
+                Record r;
+                while (m_queue.try_pop(r)) {
+                    bool is_err = r.level >= Level::Warn;
+                    print(is_err ? stderr : stdout, r);
+                    (is_err ? wrote_err : wrote_out) = true;
+                }
+
+                size_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+                if (dropped > 0) {
+                    std::fprintf(stderr, "[Log] %zu records dropped (queue full)\n", dropped);
+                    wrote_err = true;
+                }
+                if (wrote_out) std::fflush(stdout);
+                if (wrote_err) std::fflush(stderr);
+            }
+
+            static void print(FILE* out, const Record& r) {
+                auto since_epoch = r.time.time_since_epoch();
+                std::time_t secs = std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+                int ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+                std::tm tm{};
+                localtime_r(&secs, &tm);
+                std::fprintf(out, "%02d:%02d:%02d.%03d %s [%s] %.*s\n", tm.tm_hour, tm.tm_min, tm.tm_sec, ms,
+                             level_name(r.level), r.tag, static_cast<int>(r.length), r.text);
+            }
+
+            MpscRing<Record, QUEUE_CAPACITY> m_queue;
+            std::atomic<uint32_t> m_signal{0};
+            std::atomic<size_t> m_dropped{0};
+            std::atomic<bool> m_stopped{false};
+            std::thread m_thread; // Last, so it starts after the members above exist
+        };
+
+        // Never destroyed: threads that outlive main() may still log, and
+        // shutdown() (run from atexit) has already flushed by then.
+        Writer& writer() {
+            static Writer* w = [] {
+                auto* created = new Writer();
+                std::atexit(shutdown);
+                return created;
+            }();
+            return *w;
+        }
+
+    }
+
+    void submit(Record&& record) {
+        writer().submit(std::move(record));
+    }
+
+    void shutdown() {
+        writer().stop();
+    }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+// Compile-time floor for log statements: 0 debug, 1 info, 2 warn, 3 error,
+// 4 off. Statements below it expand to nothing, arguments included.
+#ifndef DISCORD_LOG_LEVEL
+#define DISCORD_LOG_LEVEL 1
+#endif
+
+namespace discord::logging {
+
+    enum class Level : uint8_t {
+        Debug,
+        Info,
+        Warn,
+        Error,
+    };
+
+    // One log line as it travels from the calling thread to the writer.
+    // The caller only concatenates its arguments into `text`; timestamps,
+    // level names and the write syscall happen on the writer thread.
+    struct Record {
+        static constexpr size_t TEXT_SIZE = 240; // Longer lines are truncated
+
+        Level level = Level::Info;
+        const char* tag = ""; // String literal, e.g. "App"
+        std::chrono::system_clock::time_point time;
+        uint16_t length = 0;
+        char text[TEXT_SIZE];
+
+        void append(std::string_view s) {
+            size_t n = std::min(s.size(), TEXT_SIZE - length);
+            std::memcpy(text + length, s.data(), n);
+            length = static_cast<uint16_t>(length + n);
+        }
+
+        template <typename T>
+        void append(const T& v) {
+            if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                append(std::string_view(v));
+            } else if constexpr (std::is_same_v<T, bool>) {
+                append(v ? std::string_view("true") : std::string_view("false"));
+            } else if constexpr (std::is_same_v<T, char>) {
+                append(std::string_view(&v, 1));
+            } else if constexpr (std::is_integral_v<T>) {
+                char buf[24];
+                auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+                append(std::string_view(buf, ptr - buf));
+            } else if constexpr (std::is_floating_point_v<T>) {
+                char buf[32];
+                int n = std::snprintf(buf, sizeof(buf), "%.2f", static_cast<double>(v));
+                append(std::string_view(buf, std::clamp(n, 0, static_cast<int>(sizeof(buf)) - 1)));
+            } else {
+                append(std::string_view(v.str())); // Snowflake and friends
+            }
+        }
+    };
+
+    // Hands a record to the writer thread (started on first use). Never
+    // blocks: if the queue is full the record is dropped and counted.
+    void submit(Record&& record);
+
+    // Writes out everything queued so far and stops the writer thread.
+    // Registered with atexit; later records are discarded.
+    void shutdown();
+
+    template <typename... Args>
+    void write(Level level, const char* tag, const Args&... args) {
+        Record r;
+        r.level = level;
+        r.tag = tag;
+        r.time = std::chrono::system_clock::now();
+        (r.append(args), ...);
+        submit(std::move(r));
+    }
+
+}
+
+#if DISCORD_LOG_LEVEL <= 0
+#define LOG_DEBUG(tag, ...) ::discord::logging::write(::discord::logging::Level::Debug, tag, __VA_ARGS__)
+#else
+#define LOG_DEBUG(tag, ...) ((void)0)
+#endif
+
+#if DISCORD_LOG_LEVEL <= 1
+#define LOG_INFO(tag, ...) ::discord::logging::write(::discord::logging::Level::Info, tag, __VA_ARGS__)
+#else
+#define LOG_INFO(tag, ...) ((void)0)
+#endif
+
+#if DISCORD_LOG_LEVEL <= 2
+#define LOG_WARN(tag, ...) ::discord::logging::write(::discord::logging::Level::Warn, tag, __VA_ARGS__)
+#else
+#define LOG_WARN(tag, ...) ((void)0)
+#endif
+
+#if DISCORD_LOG_LEVEL <= 3
+#define LOG_ERROR(tag, ...) ::discord::logging::write(::discord::logging::Level::Error, tag, __VA_ARGS__)
+#else
+#define LOG_ERROR(tag, ...) ((void)0)
+#endif
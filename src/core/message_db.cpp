@@ -0,0 +1,661 @@
+#include "message_db.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "log.hpp"
+
+namespace discord {
+
+    namespace {
+
+        constexpr char LOG_FILE[] = "log.dat";
+        constexpr char SPANS_FILE[] = "spans.dat";
+        constexpr char RUN_MAGIC[8] = {'C', 'H', 'U', 'D', 'I', 'D', 'X', '2'};
+        constexpr char SPANS_MAGIC[8] = {'C', 'H', 'U', 'D', 'S', 'P', 'N', '2'};
+        constexpr uint64_t TOMBSTONE = UINT64_MAX;
+
+        // Every log record is framed as [u32 payload size][u32 checksum]
+        // followed by the payload: [u8 kind][u64 channel][u64 id][body]
+        constexpr size_t FRAME_HEADER = 8;
+        constexpr size_t PAYLOAD_KEY = 1 + 8 + 8;
+
+        enum RecordKind : uint8_t { RecordMessage = 0, RecordTombstone = 1, RecordSpan = 2 };
+
+        struct FileHeader {
+            char magic[8];
+            uint64_t log_end;
+            uint64_t count;
+            uint64_t first_run; // Runs only: oldest run sequence number merged into this one
+        };
+
+        uint32_t frame_checksum(const char* payload, size_t size) {
+            return static_cast<uint32_t>(fnv1a64(payload, size));
+        }
+
+        template <typename F>
+        void append_record(BinaryWriter& w, RecordKind kind, Snowflake channel, Snowflake id, F&& body) {
+            size_t start = w.out.size();
+            w.out.resize(start + FRAME_HEADER);
+            w.pod(kind);
+            w.id(channel);
+            w.id(id);
+            body(w);
+            uint32_t size = static_cast<uint32_t>(w.out.size() - start - FRAME_HEADER);
+            uint32_t check = frame_checksum(w.out.data() + start + FRAME_HEADER, size);
+            std::memcpy(w.out.data() + start, &size, 4);
+            std::memcpy(w.out.data() + start + 4, &check, 4);
+        }
+
+        // Message body. The author is passed separately so the writer
+        // thread can re-encode a stored message without touching UserStore.
+        void write_message_body(BinaryWriter& w, const Message& m, const User& author) {
+            w.id(m.guild_id);
+            w.id(author.id);
+            w.str(author.username);
+            w.str(author.discriminator);
+            w.str(author.avatar);
+            w.id(m.message_reference ? m.message_reference->message_id : Snowflake{});
+            w.pod(m.timestamp);
+            w.str(m.content);
+            w.pod(static_cast<uint32_t>(m.attachments.size()));
+            for (const auto& a : m.attachments) {
+                w.id(a.id);
+                w.str(a.filename);
+                w.str(a.url);
+                w.str(a.proxy_url);
+                w.str(a.content_type);
+                w.pod(static_cast<int32_t>(a.width));
+                w.pod(static_cast<int32_t>(a.height));
+            }
+        }
+
+        bool read_message_payload(const std::string& payload, Message& m, User& author) {
+            BinaryReader r{payload.data(), payload.data() + payload.size()};
+            if (r.pod<uint8_t>() != RecordMessage) return false;
+            m.channel_id = r.id();
+            m.id = r.id();
+            m.guild_id = r.id();
+            author.id = r.id();
+            author.username = SharedString(r.str());
+            author.discriminator = SharedString(r.str());
+            author.avatar = SharedString(r.str());
+            Snowflake reply_to = r.id();
+            if (!reply_to.empty()) m.message_reference = MessageReference{reply_to, m.channel_id, m.guild_id};
+            m.timestamp = r.pod<int64_t>();
+            m.content = SharedString(r.str());
+            m.attachments.resize(r.count(8 + 4 * 4 + 4 * 2));
+            for (auto& a : m.attachments) {
+                a.id = r.id();
+                a.filename = SharedString(r.str());
+                a.url = SharedString(r.str());
+                a.proxy_url = SharedString(r.str());
+                a.content_type = SharedString(r.str());
+                a.width = r.pod<int32_t>();
+                a.height = r.pod<int32_t>();
+            }
+            return r.ok;
+        }
+
+        bool write_file(const std::string& path, const FileHeader& header, const char* data, size_t size) {
+            std::string tmp = path + ".tmp";
+            {
+                std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                file.write(data, static_cast<std::streamsize>(size));
+                if (!file) {
+                    LOG_WARN("MessageDb", "Write failed for ", tmp);
+                    return false;
+                }
+            }
+            if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+                LOG_WARN("MessageDb", "Cannot replace ", path);
+                return false;
+            }
+            return true;
+        }
+
+        bool less_key(const auto& a, const auto& b) {
+            return a.channel != b.channel ? a.channel < b.channel : a.id < b.id;
+        }
+
+    }
+
+    MessageDb::~MessageDb() {
+        close();
+    }
+
+    bool MessageDb::open(const std::string& dir) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        m_dir = dir;
+
+        std::vector<std::pair<uint64_t, std::string>> run_files;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() > 8 && name.starts_with("run-") && name.ends_with(".idx")) {
+                run_files.emplace_back(std::strtoull(name.c_str() + 4, nullptr, 10), entry.path().string());
+            }
+        }
+        std::sort(run_files.begin(), run_files.end());
+
+        // A merged run supersedes every run numbered from its first_run up;
+        // those are normally removed right after the merge, but a crash can
+        // leave them behind. Walk newest first and drop what is covered, so
+        // keys the merge deleted can't come back from a stale run.
+        uint64_t runs_end = 0;
+        uint64_t covered_from = UINT64_MAX;
+        for (auto it = run_files.rbegin(); it != run_files.rend(); ++it) {
+            const auto& [seq, path] = *it;
+            m_next_run = std::max(m_next_run, seq + 1);
+            if (seq >= covered_from) {
+                LOG_INFO("MessageDb", "Removing merged index run ", path);
+                std::remove(path.c_str());
+                continue;
+            }
+            auto run = load_run(path, seq);
+            if (!run) {
+                LOG_WARN("MessageDb", "Ignoring corrupt index run ", path);
+                continue;
+            }
+            runs_end = std::max(runs_end, run->log_end);
+            covered_from = run->first_run;
+            m_runs.push_back(std::move(run));
+        }
+        std::reverse(m_runs.begin(), m_runs.end());
+
+        std::string log_path = (fs::path(dir) / LOG_FILE).string();
+        m_log_fd = ::open(log_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (m_log_fd < 0) {
+            LOG_ERROR("MessageDb", "Cannot open ", log_path);
+            m_runs.clear();
+            return false;
+        }
+
+        // Spans are snapshotted with each run, so both usually cover the same
+        // prefix of the log. Replay from the earlier of the two; keys below
+        // runs_end are already in a run.
+        uint64_t replay_from = std::min(runs_end, load_spans());
+        {
+            MappedFile log(log_path);
+            if (log.size() < runs_end) {
+                // The index points past the log (it was replaced or cut
+                // short); rebuild from what the log still has
+                LOG_WARN("MessageDb", "Log is shorter than its index, rebuilding");
+                m_runs.clear();
+                m_spans.clear();
+                runs_end = replay_from = 0;
+            }
+            uint64_t end = replay_from;
+            while (end + FRAME_HEADER <= log.size()) {
+                uint32_t size, check;
+                std::memcpy(&size, log.data() + end, 4);
+                std::memcpy(&check, log.data() + end + 4, 4);
+                const char* payload = log.data() + end + FRAME_HEADER;
+                if (size < PAYLOAD_KEY || size > log.size() - end - FRAME_HEADER ||
+                    frame_checksum(payload, size) != check) break;
+                index_record(payload, size, end, end >= runs_end);
+                end += FRAME_HEADER + size;
+            }
+            if (end < log.size()) {
+                LOG_WARN("MessageDb", "Dropping ", log.size() - end, " bytes of torn log tail");
+                if (::ftruncate(m_log_fd, static_cast<off_t>(end)) != 0) {
+                    LOG_ERROR("MessageDb", "Cannot truncate ", log_path);
+                }
+            }
+            m_log_size = end;
+        }
+
+        m_stopping = false;
+        m_writer = std::thread([this]() { writer_loop(); });
+        LOG_INFO("MessageDb", "Opened ", dir, ": ", m_log_size / 1024, " KB log, ", m_runs.size(), " runs, ",
+                 m_memtable.size(), " keys replayed");
+        return true;
+    }
+
+    void MessageDb::close() {
+        if (m_log_fd < 0) return;
+        {
+            std::lock_guard<std::mutex> lock(m_queue_mutex);
+            m_stopping = true;
+        }
+        m_queue_cv.notify_one();
+        if (m_writer.joinable()) m_writer.join();
+
+        // Spare the next open a replay
+        if (!m_memtable.empty()) write_run();
+        ::close(m_log_fd);
+        m_log_fd = -1;
+    }
+
+    template <typename F>
+    void MessageDb::enqueue(F&& write) {
+        bool notify;
+        {
+            std::lock_guard<std::mutex> lock(m_queue_mutex);
+            // The writer wakes for the first op of a batch, then lingers
+            // for BATCH_INTERVAL unless the batch fills up
+            bool idle = m_queued_ops == m_taken_ops;
+            write();
+            ++m_queued_ops;
+            notify = idle || m_pending.out.size() >= BATCH_BYTES;
+        }
+        if (notify) m_queue_cv.notify_one();
+    }
+
+    void MessageDb::put(std::span<const Message> msgs, Snowflake older, Snowflake newer) {
+        if (msgs.empty() || m_log_fd < 0) return;
+        enqueue([&]() {
+            for (const auto& m : msgs) {
+                append_record(m_pending, RecordMessage, m.channel_id, m.id,
+                              [&](BinaryWriter& w) { write_message_body(w, m, *m.author); });
+            }
+            Snowflake lo = older.empty() ? msgs.front().id : older;
+            Snowflake hi = newer.empty() ? msgs.back().id : newer;
+            append_record(m_pending, RecordSpan, msgs.front().channel_id, lo, [&](BinaryWriter& w) { w.id(hi); });
+        });
+    }
+
+    void MessageDb::update(const MessageUpdateEvent& update) {
+        if (m_log_fd < 0 || (!update.content && !update.attachments)) return;
+        // Needs the stored version, so it is patched on the writer thread
+        enqueue([&]() { m_pending_updates.push_back(update); });
+    }
+
+    void MessageDb::erase(Snowflake channel_id, std::span<const Snowflake> ids) {
+        if (ids.empty() || m_log_fd < 0) return;
+        enqueue([&]() {
+            for (Snowflake id : ids) append_record(m_pending, RecordTombstone, channel_id, id, [](BinaryWriter&) {});
+        });
+    }
+
+    void MessageDb::flush() {
+        if (m_log_fd < 0) return;
+        std::unique_lock<std::mutex> lock(m_queue_mutex);
+        uint64_t target = m_queued_ops;
+        if (m_written_ops >= target) return;
+        m_flush_requested = true;
+        m_queue_cv.notify_one();
+        m_written_cv.wait(lock, [&]() { return m_written_ops >= target; });
+    }
+
+    void MessageDb::writer_loop() {
+        std::unique_lock<std::mutex> lock(m_queue_mutex);
+        for (;;) {
+            m_queue_cv.wait(lock, [&]() { return m_stopping || m_queued_ops > m_taken_ops; });
+            if (m_queued_ops == m_taken_ops) return; // Stopping with nothing left
+
+            if (!m_stopping && !m_flush_requested && m_pending.out.size() < BATCH_BYTES) {
+                m_queue_cv.wait_for(lock, BATCH_INTERVAL, [&]() {
+                    return m_stopping || m_flush_requested || m_pending.out.size() >= BATCH_BYTES;
+                });
+            }
+
+            std::string records;
+            records.swap(m_pending.out);
+            std::vector<MessageUpdateEvent> updates;
+            updates.swap(m_pending_updates);
+            uint64_t ops = m_queued_ops;
+            m_taken_ops = ops;
+            m_flush_requested = false;
+            lock.unlock();
+
+            apply(records, updates);
+
+            lock.lock();
+            m_written_ops = ops;
+            m_written_cv.notify_all();
+        }
+    }
+
+    void MessageDb::apply(const std::string& records, std::vector<MessageUpdateEvent>& updates) {
+        append_to_log(records);
+
+        // Edits append a full new version of the stored message. Updates
+        // are applied after the batch's other records, which is harmless:
+        // one for a message deleted in the same batch finds the tombstone.
+        BinaryWriter patched;
+        std::string payload;
+        for (auto& u : updates) {
+            std::optional<uint64_t> offset;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+                offset = lookup(Key{u.channel_id.value, u.id.value});
+            }
+            Message m;
+            User author;
+            if (!offset || !read_frame(*offset, payload) || !read_message_payload(payload, m, author)) continue;
+            if (u.content) m.content = std::move(*u.content);
+            if (u.attachments) m.attachments = std::move(*u.attachments);
+            append_record(patched, RecordMessage, m.channel_id, m.id,
+                          [&](BinaryWriter& w) { write_message_body(w, m, author); });
+        }
+        append_to_log(patched.out);
+
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+        if (m_memtable.size() >= MEMTABLE_LIMIT) write_run();
+    }
+
+    void MessageDb::append_to_log(const std::string& records) {
+        if (records.empty()) return;
+        uint64_t base = m_log_size;
+        size_t written = 0;
+        while (written < records.size()) {
+            ssize_t n = ::write(m_log_fd, records.data() + written, records.size() - written);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                LOG_ERROR("MessageDb", "Log write failed after ", written, " of ", records.size(), " bytes");
+                // Leave the partial record for the next open to truncate;
+                // nothing from this batch gets indexed
+                m_log_size = base + written;
+                return;
+            }
+            written += static_cast<size_t>(n);
+        }
+
+        uint64_t count = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+            for (size_t pos = 0; pos + FRAME_HEADER <= records.size();) {
+                uint32_t size;
+                std::memcpy(&size, records.data() + pos, 4);
+                index_record(records.data() + pos + FRAME_HEADER, size, base + pos, true);
+                pos += FRAME_HEADER + size;
+                ++count;
+            }
+        }
+        m_log_size = base + records.size();
+        m_records_written.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void MessageDb::index_record(const char* payload, uint32_t size, uint64_t offset, bool keys) {
+        BinaryReader r{payload, payload + size};
+        uint8_t kind = r.pod<uint8_t>();
+        uint64_t channel = r.pod<uint64_t>();
+        uint64_t id = r.pod<uint64_t>();
+        switch (kind) {
+            case RecordMessage:
+                if (keys) m_memtable[Key{channel, id}] = offset;
+                break;
+            case RecordTombstone:
+                if (keys) m_memtable[Key{channel, id}] = TOMBSTONE;
+                break;
+            case RecordSpan: {
+                uint64_t hi = r.pod<uint64_t>();
+                if (r.ok) add_span(channel, std::min(id, hi), std::max(id, hi));
+                break;
+            }
+        }
+    }
+
+    void MessageDb::add_span(uint64_t channel, uint64_t lo, uint64_t hi) {
+        // Merge with every span it overlaps or touches; spans are disjoint,
+        // so those are the ones just before the first span starting past hi
+        auto& spans = m_spans[channel];
+        auto it = spans.upper_bound(hi);
+        while (it != spans.begin()) {
+            auto prev = std::prev(it);
+            if (prev->second < lo) break;
+            lo = std::min(lo, prev->first);
+            hi = std::max(hi, prev->second);
+            it = spans.erase(prev);
+        }
+        spans.emplace(lo, hi);
+    }
+
+    void MessageDb::write_run() {
+        // Only this thread modifies the memtable, so reading it unlocked is safe
+        std::vector<IndexEntry> entries;
+        entries.reserve(m_memtable.size());
+        for (const auto& [key, offset] : m_memtable) entries.push_back({key.channel, key.id, offset});
+
+        auto run = write_run_file(entries, m_log_size, m_next_run);
+        if (!run) return; // Keep the memtable; the next batch retries
+        write_spans(m_log_size);
+        {
+            std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+            m_runs.push_back(std::move(run));
+            m_memtable.clear();
+        }
+        compact();
+    }
+
+    void MessageDb::compact() {
+        while (m_runs.size() >= 2) {
+            const auto& newer = m_runs[m_runs.size() - 1];
+            const auto& older = m_runs[m_runs.size() - 2];
+            if (newer->entries.size() * 2 < older->entries.size()) break;
+
+            // Tombstones only have to shadow older runs; once the oldest run
+            // takes part in the merge they can go
+            bool drop_tombstones = m_runs.size() == 2;
+            std::vector<IndexEntry> merged;
+            merged.reserve(newer->entries.size() + older->entries.size());
+            auto a = older->entries.begin(), a_end = older->entries.end();
+            auto b = newer->entries.begin(), b_end = newer->entries.end();
+            auto emit = [&](const IndexEntry& e) {
+                if (!drop_tombstones || e.offset != TOMBSTONE) merged.push_back(e);
+            };
+            while (a != a_end || b != b_end) {
+                if (b == b_end || (a != a_end && less_key(*a, *b))) {
+                    emit(*a++);
+                } else {
+                    if (a != a_end && !less_key(*b, *a)) ++a; // Same key: the newer run wins
+                    emit(*b++);
+                }
+            }
+
+            // The merged run records the oldest run it replaces, so reopening
+            // after a crash before the removal below still ignores the inputs
+            auto run = write_run_file(merged, newer->log_end, older->first_run);
+            if (!run) return;
+            std::string stale[2] = {older->path, newer->path};
+            {
+                std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+                m_runs.resize(m_runs.size() - 2);
+                m_runs.push_back(std::move(run));
+            }
+            // Readers still holding the old runs keep their mappings
+            for (const auto& path : stale) std::remove(path.c_str());
+        }
+    }
+
+    std::shared_ptr<const MessageDb::Run> MessageDb::write_run_file(const std::vector<IndexEntry>& entries, uint64_t log_end, uint64_t first_run) {
+        uint64_t seq = m_next_run++;
+        char name[32];
+        std::snprintf(name, sizeof(name), "run-%08llu.idx", static_cast<unsigned long long>(seq));
+        std::string path = (std::filesystem::path(m_dir) / name).string();
+
+        FileHeader header{};
+        std::memcpy(header.magic, RUN_MAGIC, sizeof(RUN_MAGIC));
+        header.log_end = log_end;
+        header.count = entries.size();
+        header.first_run = first_run;
+        if (!write_file(path, header, reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(IndexEntry))) {
+            return nullptr;
+        }
+        return load_run(path, seq);
+    }
+
+    std::shared_ptr<const MessageDb::Run> MessageDb::load_run(const std::string& path, uint64_t seq) const {
+        auto run = std::make_shared<Run>(path);
+        const MappedFile& file = run->file;
+        FileHeader header;
+        if (file.size() < sizeof(header)) return nullptr;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, RUN_MAGIC, sizeof(RUN_MAGIC)) != 0 ||
+            header.count != (file.size() - sizeof(header)) / sizeof(IndexEntry) ||
+            (file.size() - sizeof(header)) % sizeof(IndexEntry) != 0 || header.first_run > seq) {
+            return nullptr;
+        }
+        run->seq = seq;
+        run->first_run = header.first_run;
+        run->log_end = header.log_end;
+        run->entries = {reinterpret_cast<const IndexEntry*>(file.data() + sizeof(header)), header.count};
+        return run;
+    }
+
+    void MessageDb::write_spans(uint64_t log_end) const {
+        BinaryWriter w;
+        size_t count = 0;
+        for (const auto& [channel, spans] : m_spans) {
+            for (const auto& [lo, hi] : spans) {
+                w.pod(channel);
+                w.pod(lo);
+                w.pod(hi);
+                ++count;
+            }
+        }
+        FileHeader header{};
+        std::memcpy(header.magic, SPANS_MAGIC, sizeof(SPANS_MAGIC));
+        header.log_end = log_end;
+        header.count = count;
+        write_file((std::filesystem::path(m_dir) / SPANS_FILE).string(), header, w.out.data(), w.out.size());
+    }
+
+    uint64_t MessageDb::load_spans() {
+        MappedFile file((std::filesystem::path(m_dir) / SPANS_FILE).string());
+        FileHeader header;
+        if (file.size() < sizeof(header)) return 0;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, SPANS_MAGIC, sizeof(SPANS_MAGIC)) != 0 ||
+            header.count != (file.size() - sizeof(header)) / 24) {
+            return 0;
+        }
+        BinaryReader r{file.data() + sizeof(header), file.data() + file.size()};
+        for (uint64_t i = 0; i < header.count; ++i) {
+            uint64_t channel = r.pod<uint64_t>();
+            uint64_t lo = r.pod<uint64_t>();
+            uint64_t hi = r.pod<uint64_t>();
+            add_span(channel, lo, hi);
+        }
+        return header.log_end;
+    }
+
+    std::optional<uint64_t> MessageDb::lookup(Key key) const {
+        auto it = m_memtable.find(key);
+        if (it != m_memtable.end()) return it->second != TOMBSTONE ? std::optional(it->second) : std::nullopt;
+        for (auto run = m_runs.rbegin(); run != m_runs.rend(); ++run) {
+            const auto& entries = (*run)->entries;
+            auto e = std::lower_bound(entries.begin(), entries.end(), key, [](const IndexEntry& a, const Key& k) { return less_key(a, k); });
+            if (e != entries.end() && e->channel == key.channel && e->id == key.id) {
+                return e->offset != TOMBSTONE ? std::optional(e->offset) : std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool MessageDb::read_frame(uint64_t offset, std::string& payload) const {
+        uint32_t frame[2];
+        if (::pread(m_log_fd, frame, sizeof(frame), static_cast<off_t>(offset)) != sizeof(frame)) return false;
+        payload.resize(frame[0]);
+        if (::pread(m_log_fd, payload.data(), frame[0], static_cast<off_t>(offset + FRAME_HEADER)) != static_cast<ssize_t>(frame[0])) {
+            return false;
+        }
+        return frame_checksum(payload.data(), payload.size()) == frame[1];
+    }
+
+    std::optional<Message> MessageDb::get(Snowflake channel_id, Snowflake id) const {
+        if (m_log_fd < 0) return std::nullopt;
+        std::optional<uint64_t> offset;
+        {
+            std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+            offset = lookup(Key{channel_id.value, id.value});
+        }
+        std::string payload;
+        Message m;
+        User author;
+        if (!offset || !read_frame(*offset, payload) || !read_message_payload(payload, m, author)) return std::nullopt;
+        m.author = UserStore::global().intern_snapshot(std::move(author));
+        return m;
+    }
+
+    std::vector<Message> MessageDb::before(Snowflake channel_id, Snowflake before, size_t limit) const {
+        if (m_log_fd < 0 || limit == 0) return {};
+        const uint64_t channel = channel_id.value;
+
+        std::vector<uint64_t> offsets; // Newest first
+        {
+            std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+            auto spans = m_spans.find(channel);
+            if (spans == m_spans.end()) return {};
+            auto span = spans->second.upper_bound(before.value);
+            if (span == spans->second.begin()) return {};
+            --span;
+            if (span->second < before.value) return {};
+            const uint64_t lo = span->first;
+
+            // Walk every source backwards from `before` in step, taking each
+            // key from the newest source that has it
+            auto mem_begin = m_memtable.lower_bound(Key{channel, lo});
+            auto mem = m_memtable.lower_bound(Key{channel, before.value});
+            std::vector<std::pair<const IndexEntry*, const IndexEntry*>> runs; // [first, cursor), newest first
+            auto by_key = [](const IndexEntry& a, const Key& k) { return less_key(a, k); };
+            for (auto run = m_runs.rbegin(); run != m_runs.rend(); ++run) {
+                const auto& entries = (*run)->entries;
+                auto first = std::lower_bound(entries.begin(), entries.end(), Key{channel, lo}, by_key);
+                auto cursor = std::lower_bound(first, entries.end(), Key{channel, before.value}, by_key);
+                if (first != cursor) runs.emplace_back(&*first, &*first + (cursor - first));
+            }
+
+            while (offsets.size() < limit) {
+                uint64_t id = 0;
+                bool any = false;
+                if (mem != mem_begin) {
+                    id = std::prev(mem)->first.id;
+                    any = true;
+                }
+                for (const auto& [first, cursor] : runs) {
+                    if (cursor != first) {
+                        id = std::max(id, (cursor - 1)->id);
+                        any = true;
+                    }
+                }
+                if (!any) break;
+
+                std::optional<uint64_t> offset;
+                if (mem != mem_begin && std::prev(mem)->first.id == id) offset = (--mem)->second;
+                for (auto& [first, cursor] : runs) {
+                    if (cursor != first && (cursor - 1)->id == id) {
+                        if (!offset) offset = (cursor - 1)->offset;
+                        --cursor;
+                    }
+                }
+                if (*offset != TOMBSTONE) offsets.push_back(*offset);
+            }
+        }
+
+        std::vector<Message> result;
+        result.reserve(offsets.size());
+        std::string payload;
+        for (auto it = offsets.rbegin(); it != offsets.rend(); ++it) {
+            Message m;
+            User author;
+            if (!read_frame(*it, payload) || !read_message_payload(payload, m, author)) {
+                // A hole in the middle would make the page lie about being
+                // gap-free; return only what follows it
+                result.clear();
+                continue;
+            }
+            m.author = UserStore::global().intern_snapshot(std::move(author));
+            result.push_back(std::move(m));
+        }
+        return result;
+    }
+
+    MessageDb::Stats MessageDb::stats() const {
+        Stats s;
+        s.records = m_records_written.load(std::memory_order_relaxed);
+        s.batches = m_batches.load(std::memory_order_relaxed);
+        std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+        s.runs = m_runs.size();
+        s.memtable = m_memtable.size();
+        return s;
+    }
+
+}
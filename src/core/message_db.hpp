@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <compare>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "../discord/models.hpp"
+
+namespace discord {
+
+    // Embedded store for every message the client has seen, keyed by
+    // (channel, message ID), so scrollback survives restarts and doesn't
+    // have to go to REST. The database directory holds:
+    //
+    //   log.dat     Append-only records: messages (an edit appends a full
+    //               new version), delete tombstones and history spans.
+    //   run-N.idx   Sorted, immutable index runs mapping keys to log
+    //               offsets; memory-mapped and binary searched. A merged
+    //               run names the oldest run it replaced, and open()
+    //               discards any run such a merge covers.
+    //   spans.dat   Snapshot of the spans, written together with each run.
+    //
+    // The index is a small LSM tree. New keys go to an ordered in-memory
+    // memtable, which becomes a new run once it holds MEMTABLE_LIMIT keys;
+    // a run at least half the size of the one before it is merged into it,
+    // which keeps the run count logarithmic. Lookups check the memtable and
+    // then the runs from newest to oldest, so the latest version of a key
+    // wins. On open, the log written after the newest run is replayed.
+    //
+    // Spans record which stretches of a channel's history are known to be
+    // gap-free (a REST page, or gateway messages following a synced
+    // history). before() only answers from inside a span, so local
+    // scrollback never silently skips messages the client never saw.
+    //
+    // Writes are queued and applied by a writer thread in batches, one
+    // write() per batch. Reads are safe from any thread and see every
+    // applied batch; flush() waits for the queue to drain.
+    class MessageDb {
+    public:
+        static constexpr size_t MEMTABLE_LIMIT = 256 * 1024;
+        static constexpr size_t BATCH_BYTES = 1024 * 1024; // Queued bytes that trigger a write right away
+        static constexpr auto BATCH_INTERVAL = std::chrono::milliseconds(50);
+
+        struct Stats {
+            uint64_t records = 0;
+            uint64_t batches = 0;
+            size_t runs = 0;
+            size_t memtable = 0;
+        };
+
+        MessageDb() = default;
+        ~MessageDb();
+
+        MessageDb(const MessageDb&) = delete;
+        MessageDb& operator=(const MessageDb&) = delete;
+
+        bool open(const std::string& dir);
+        void close();
+
+        // Queues msgs (one channel, oldest first) as a gap-free stretch of
+        // history. `older` and `newer` optionally name stored messages
+        // directly before and after it, extending the span across them.
+        // Call on the main thread: authors are read from UserStore.
+        void put(std::span<const Message> msgs, Snowflake older = {}, Snowflake newer = {});
+        void update(const MessageUpdateEvent& update);
+        void erase(Snowflake channel_id, std::span<const Snowflake> ids);
+
+        // Blocks until everything queued so far is in the log and index
+        void flush();
+
+        std::optional<Message> get(Snowflake channel_id, Snowflake id) const;
+
+        // Up to `limit` stored messages directly preceding `before` (oldest
+        // first), stopping where the span containing `before` starts. Empty
+        // if `before` isn't inside a known span.
+        std::vector<Message> before(Snowflake channel_id, Snowflake before, size_t limit) const;
+
+        Stats stats() const;
+
+    private:
+        struct Key {
+            uint64_t channel;
+            uint64_t id;
+            auto operator<=>(const Key&) const = default;
+        };
+
+        struct IndexEntry {
+            uint64_t channel;
+            uint64_t id;
+            uint64_t offset; // TOMBSTONE for deleted messages
+        };
+
+        struct Run {
+            explicit Run(const std::string& p) : path(p), file(p) {}
+
+            std::string path;
+            MappedFile file;
+            uint64_t seq = 0;
+            uint64_t first_run = 0; // Oldest run merged into this one; seq if none
+            uint64_t log_end = 0;   // Log offset this run (and older ones) cover
+            std::span<const IndexEntry> entries;
+        };
+
+        template <typename F>
+        void enqueue(F&& write);
+        void writer_loop();
+        void apply(const std::string& records, std::vector<MessageUpdateEvent>& updates);
+        void append_to_log(const std::string& records);
+        void index_record(const char* payload, uint32_t size, uint64_t offset, bool keys);
+        void add_span(uint64_t channel, uint64_t lo, uint64_t hi);
+
+        void write_run();
+        void compact();
+        std::shared_ptr<const Run> write_run_file(const std::vector<IndexEntry>& entries, uint64_t log_end, uint64_t first_run);
+        std::shared_ptr<const Run> load_run(const std::string& path, uint64_t seq) const;
+        void write_spans(uint64_t log_end) const;
+        uint64_t load_spans();
+
+        // Requires m_index_mutex (shared or unique)
+        std::optional<uint64_t> lookup(Key key) const;
+        bool read_frame(uint64_t offset, std::string& payload) const;
+
+        std::string m_dir;
+        int m_log_fd = -1;
+        uint64_t m_log_size = 0; // Written only by the writer thread
+        uint64_t m_next_run = 0;
+
+        // Index state. The writer thread is the only one that modifies it.
+        mutable std::shared_mutex m_index_mutex;
+        std::map<Key, uint64_t> m_memtable;
+        std::vector<std::shared_ptr<const Run>> m_runs; // Oldest first
+        std::unordered_map<uint64_t, std::map<uint64_t, uint64_t>> m_spans; // channel -> span start -> end
+
+        // Write queue
+        std::mutex m_queue_mutex;
+        std::condition_variable m_queue_cv;
+        std::condition_variable m_written_cv;
+        BinaryWriter m_pending;
+        std::vector<MessageUpdateEvent> m_pending_updates;
+        uint64_t m_queued_ops = 0;
+        uint64_t m_taken_ops = 0;
+        uint64_t m_written_ops = 0;
+        bool m_flush_requested = false;
+        bool m_stopping = false;
+        std::thread m_writer;
+
+        std::atomic<uint64_t> m_records_written{0};
+        std::atomic<uint64_t> m_batches{0};
+    };
+
+}
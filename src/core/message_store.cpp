@@ -0,0 +1,312 @@
+#include "message_store.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace discord {
+
+    namespace {
+
+        constexpr size_t ALIGN = alignof(std::max_align_t);
+
+        constexpr size_t align_up(size_t n, size_t a) {
+            return (n + a - 1) & ~(a - 1);
+        }
+
+        // Sequential writer over a single arena block
+        struct BlockWriter {
+            std::byte* cursor;
+
+            std::string_view copy(std::string_view s) {
+                char* dst = reinterpret_cast<char*>(cursor);
+                std::memcpy(dst, s.data(), s.size());
+                dst[s.size()] = '\0';
+                cursor += s.size() + 1;
+                return std::string_view(dst, s.size());
+            }
+        };
+
+    }
+
+    Arena::Block Arena::allocate(size_t size) {
+        size = align_up(size, ALIGN);
+
+        if (size > PAGE_SIZE / 2) {
+            uint32_t page = new_page(size);
+            Page& p = m_pages[page];
+            p.used = size;
+            p.live = 1;
+            m_stats.bytes_used += size;
+            return {p.data.get(), page};
+        }
+
+        if (m_current == UINT32_MAX || m_pages[m_current].used + size > m_pages[m_current].capacity) {
+            // The previous page is kept alive by its messages until they are released
+            if (m_current != UINT32_MAX && m_pages[m_current].live == 0) free_page(m_current);
+            m_current = new_page(PAGE_SIZE);
+        }
+
+        Page& p = m_pages[m_current];
+        std::byte* data = p.data.get() + p.used;
+        p.used += size;
+        p.live++;
+        m_stats.bytes_used += size;
+        return {data, m_current};
+    }
+
+    void Arena::release(uint32_t page) {
+        Page& p = m_pages[page];
+        if (--p.live > 0) return;
+
+        if (page == m_current) {
+            // Keep the bump page around but start over from its beginning
+            m_stats.bytes_used -= p.used;
+            p.used = 0;
+        } else {
+            free_page(page);
+        }
+    }
+
+    void Arena::clear() {
+        m_pages.clear();
+        m_free_slots.clear();
+        m_current = UINT32_MAX;
+        m_stats.pages = 0;
+        m_stats.bytes_reserved = 0;
+        m_stats.bytes_used = 0;
+    }
+
+    uint32_t Arena::new_page(size_t capacity) {
+        uint32_t index;
+        if (!m_free_slots.empty()) {
+            index = m_free_slots.back();
+            m_free_slots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_pages.size());
+            m_pages.emplace_back();
+        }
+
+        Page& p = m_pages[index];
+        p.data.reset(new std::byte[capacity]);
+        p.capacity = capacity;
+        p.used = 0;
+        p.live = 0;
+
+        m_stats.pages++;
+        m_stats.bytes_reserved += capacity;
+        m_stats.page_allocations++;
+        return index;
+    }
+
+    void Arena::free_page(uint32_t page) {
+        Page& p = m_pages[page];
+        m_stats.pages--;
+        m_stats.bytes_reserved -= p.capacity;
+        m_stats.bytes_used -= p.used;
+        p.data.reset();
+        p.capacity = 0;
+        p.used = 0;
+        m_free_slots.push_back(page);
+        if (page == m_current) m_current = UINT32_MAX;
+    }
+
+    template <typename A>
+    void ChannelHistory::pack(size_t p, std::string_view content, std::span<const A> source) {
+        // Layout: [attachments][content\0][attachment strings\0...]
+        size_t attachments_size = align_up(source.size() * sizeof(StoredAttachment), ALIGN);
+        size_t size = attachments_size + content.size() + 1;
+        for (const auto& a : source) {
+            size += a.filename.size() + a.url.size() + a.proxy_url.size() + a.content_type.size() + 4;
+        }
+
+        Arena::Block block = m_arena.allocate(size);
+        auto* attachments = reinterpret_cast<StoredAttachment*>(block.data);
+        BlockWriter w{block.data + attachments_size};
+
+        m_pages[p] = block.page;
+        m_contents[p] = w.copy(content);
+
+        for (size_t i = 0; i < source.size(); ++i) {
+            const A& a = source[i];
+            StoredAttachment* sa = new (&attachments[i]) StoredAttachment;
+            sa->id = a.id;
+            sa->filename = w.copy(a.filename);
+            sa->url = w.copy(a.url);
+            sa->proxy_url = w.copy(a.proxy_url);
+            sa->content_type = w.copy(a.content_type);
+            sa->width = a.width;
+            sa->height = a.height;
+        }
+        m_attachments[p] = std::span<const StoredAttachment>(attachments, source.size());
+    }
+
+    void ChannelHistory::store(size_t p, const Message& m) {
+        m_ids[p] = m.id;
+        m_authors[p] = m.author;
+        m_reply_to[p] = m.message_reference ? m.message_reference->message_id : Snowflake{};
+        m_timestamps[p] = m.timestamp;
+        pack(p, m.content, std::span<const Attachment>(m.attachments));
+
+        if (!m.guild_id.empty()) m_guild_id = m.guild_id;
+    }
+
+    void ChannelHistory::patch(size_t i, const std::optional<SharedString>& content,
+                               const std::optional<std::vector<Attachment>>& attachments) {
+        size_t p = pos(i);
+        m_version = next_version();
+        if (!attachments) {
+            if (!content) return;
+            std::string_view old = m_contents[p];
+            if (content->size() <= old.size()) {
+                // The block is ours and the old text is NUL-terminated in place
+                char* dst = const_cast<char*>(old.data());
+                std::memcpy(dst, content->data(), content->size());
+                dst[content->size()] = '\0';
+                m_contents[p] = std::string_view(dst, content->size());
+                return;
+            }
+        }
+
+        // Repack from the old block before releasing it
+        uint32_t old_page = m_pages[p];
+        std::string_view text = content ? content->view() : m_contents[p];
+        if (attachments) pack(p, text, std::span<const Attachment>(*attachments));
+        else pack(p, text, m_attachments[p]);
+        m_arena.release(old_page);
+    }
+
+    size_t ChannelHistory::erase(std::span<const Snowflake> ids) {
+        std::vector<bool> dead(m_size);
+        size_t first = m_size;
+        size_t removed = 0;
+        for (Snowflake id : ids) {
+            size_t i = find(id);
+            if (i == npos || dead[i]) continue;
+            dead[i] = true;
+            first = std::min(first, i);
+            ++removed;
+        }
+        if (removed == 0) return 0;
+
+        size_t out = first;
+        for (size_t i = first; i < m_size; ++i) {
+            size_t src = pos(i);
+            if (dead[i]) {
+                m_arena.release(m_pages[src]);
+                continue;
+            }
+            size_t dst = pos(out++);
+            for_each_column([&](auto& column) { column[dst] = column[src]; });
+        }
+        m_size = out;
+        m_version = next_version();
+        return removed;
+    }
+
+    uint64_t ChannelHistory::next_version() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    void ChannelHistory::reslot(size_t slots) {
+        for_each_column([&](auto& column) {
+            std::remove_reference_t<decltype(column)> linear;
+            linear.reserve(slots);
+            for (size_t i = 0; i < m_size; ++i) linear.push_back(column[pos(i)]);
+            linear.resize(slots);
+            column = std::move(linear);
+        });
+        m_slots = slots;
+        m_head = 0;
+    }
+
+    MessageView ChannelHistory::operator[](size_t i) const {
+        size_t p = pos(i);
+        return MessageView{m_ids[p], m_authors[p], m_reply_to[p], m_contents[p], m_timestamps[p], m_attachments[p]};
+    }
+
+    void ChannelHistory::append(const Message& m) {
+        if (m_size == m_capacity) evict_oldest(1);
+        if (m_size == m_slots) reslot(std::min(m_capacity, std::max<size_t>(16, m_slots * 2)));
+        store(pos(m_size), m);
+        m_size++;
+        m_version = next_version();
+    }
+
+    bool ChannelHistory::prepend(const Message& m) {
+        if (m_size == m_capacity) return false;
+        if (m_size == m_slots) reslot(std::min(m_capacity, std::max<size_t>(16, m_slots * 2)));
+        m_head = (m_head + m_slots - 1) % m_slots;
+        store(m_head, m);
+        m_size++;
+        m_version = next_version();
+        return true;
+    }
+
+    void ChannelHistory::assign(const std::vector<Message>& msgs) {
+        clear();
+        size_t skip = msgs.size() > m_capacity ? msgs.size() - m_capacity : 0;
+        reslot(std::min(m_capacity, std::max<size_t>(16, msgs.size() - skip)));
+        for (size_t i = skip; i < msgs.size(); ++i) append(msgs[i]);
+    }
+
+    void ChannelHistory::evict_oldest(size_t count) {
+        count = std::min(count, m_size);
+        for (size_t i = 0; i < count; ++i) {
+            m_arena.release(m_pages[m_head]);
+            m_head = (m_head + 1) % m_slots;
+            m_size--;
+        }
+        if (count > 0) m_version = next_version();
+    }
+
+    void ChannelHistory::clear() {
+        for_each_column([](auto& column) {
+            column.clear();
+            column.shrink_to_fit();
+        });
+        m_slots = 0;
+        m_head = 0;
+        m_size = 0;
+        m_arena.clear();
+        m_version = next_version();
+    }
+
+    void ChannelHistory::set_capacity(size_t capacity) {
+        capacity = capacity ? capacity : 1;
+        if (m_size > capacity) evict_oldest(m_size - capacity);
+        m_capacity = capacity;
+        if (m_slots > capacity) reslot(capacity);
+    }
+
+    size_t ChannelHistory::find(Snowflake id) const {
+        // History is ID-ordered, so the ID column doubles as the index
+        size_t lo = 0, hi = m_size;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (id_at(mid) < id) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < m_size && id_at(lo) == id ? lo : npos;
+    }
+
+    size_t ChannelHistory::count_after(Snowflake id) const {
+        size_t lo = 0, hi = m_size;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (id_at(mid) <= id) lo = mid + 1;
+            else hi = mid;
+        }
+        return m_size - lo;
+    }
+
+    size_t ChannelHistory::memory_usage() const {
+        size_t per_slot = sizeof(Snowflake) * 2 + sizeof(UserHandle) + sizeof(uint32_t) + sizeof(int64_t) +
+                          sizeof(std::string_view) + sizeof(std::span<const StoredAttachment>);
+        return m_arena.stats().bytes_reserved + m_slots * per_slot;
+    }
+
+}
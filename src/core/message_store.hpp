@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../discord/models.hpp"
+
+namespace discord {
+
+    // Page-based bump allocator. Every allocation is tagged with the page it
+    // came from; callers release allocations per page and a page is returned
+    // to the system as a whole once nothing references it anymore.
+    class Arena {
+    public:
+        static constexpr size_t PAGE_SIZE = 16 * 1024;
+
+        struct Block {
+            std::byte* data;
+            uint32_t page;
+        };
+
+        struct Stats {
+            size_t pages = 0;
+            size_t bytes_reserved = 0;
+            size_t bytes_used = 0;
+            size_t page_allocations = 0; // Lifetime count of pages obtained from the heap
+        };
+
+        Arena() = default;
+        Arena(Arena&&) noexcept = default;
+        Arena& operator=(Arena&&) noexcept = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Allocates `size` bytes (max_align_t aligned) and takes a reference
+        // on the owning page. Requests larger than half a page get a
+        // dedicated page so they don't waste the tail of the current one.
+        Block allocate(size_t size);
+
+        // Drops one reference taken by allocate(); frees the page when unused.
+        void release(uint32_t page);
+
+        void clear();
+
+        const Stats& stats() const { return m_stats; }
+
+    private:
+        struct Page {
+            std::unique_ptr<std::byte[]> data;
+            size_t capacity = 0;
+            size_t used = 0;
+            uint32_t live = 0;
+        };
+
+        uint32_t new_page(size_t capacity);
+        void free_page(uint32_t page);
+
+        std::vector<Page> m_pages;
+        std::vector<uint32_t> m_free_slots;
+        uint32_t m_current = UINT32_MAX; // Page currently being bump-allocated from
+        Stats m_stats;
+    };
+
+    struct StoredAttachment {
+        Snowflake id;
+        std::string_view filename;
+        std::string_view url;
+        std::string_view proxy_url;
+        std::string_view content_type;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Read-only view of one message in a ChannelHistory, assembled from the
+    // history's columns. Text and attachments live in the channel's arena;
+    // string views are NUL-terminated so they can be handed to printf-style
+    // APIs through data(). Valid until the history is modified.
+    struct MessageView {
+        Snowflake id;
+        UserHandle author;
+        Snowflake reply_to; // Referenced message ID, empty if not a reply
+        std::string_view content;
+        int64_t timestamp; // Milliseconds since the Unix epoch
+        std::span<const StoredAttachment> attachments;
+    };
+
+    // Message history of a single channel, oldest first. Each message is
+    // packed into one contiguous arena block together with its strings and
+    // attachments, so loading history costs one bump allocation per message
+    // and evicting old messages releases whole pages.
+    //
+    // The per-message fields are stored column-wise, so passes that touch
+    // one field (ID lookups, unread counting, content search) stream through
+    // a dense array instead of striding over whole records. The columns form
+    // a ring buffer bounded by capacity(): appending to a full history
+    // overwrites the oldest message, and older history that doesn't fit is
+    // rejected by prepend().
+    class ChannelHistory {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 500;
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = MessageView;
+            using difference_type = std::ptrdiff_t;
+            using reference = MessageView;
+
+            const_iterator() = default;
+            const_iterator(const ChannelHistory* h, size_t i) : m_history(h), m_index(i) {}
+
+            MessageView operator*() const { return (*m_history)[m_index]; }
+            const_iterator& operator++() { ++m_index; return *this; }
+            const_iterator operator++(int) { auto tmp = *this; ++m_index; return tmp; }
+            bool operator==(const const_iterator& o) const { return m_index == o.m_index; }
+
+        private:
+            const ChannelHistory* m_history = nullptr;
+            size_t m_index = 0;
+        };
+
+        explicit ChannelHistory(size_t capacity = DEFAULT_CAPACITY) : m_capacity(capacity ? capacity : 1) {}
+        ChannelHistory(ChannelHistory&&) noexcept = default;
+        ChannelHistory& operator=(ChannelHistory&&) noexcept = default;
+
+        void append(const Message& m);
+        bool prepend(const Message& m);
+
+        // Replaces the whole history with msgs (oldest first); only the
+        // newest capacity() messages are kept.
+        void assign(const std::vector<Message>& msgs);
+
+        // Edits message i in place; an empty optional keeps the current
+        // value. New text that fits in the old text's space is written over
+        // it; anything else repacks the message into a fresh block.
+        void patch(size_t i, const std::optional<SharedString>& content,
+                   const std::optional<std::vector<Attachment>>& attachments);
+
+        // Removes the messages with the given IDs (unknown IDs are ignored):
+        // hits are marked first, then the columns are compacted in a single
+        // pass. Returns the number removed.
+        size_t erase(std::span<const Snowflake> ids);
+
+        void evict_oldest(size_t count);
+        void clear();
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        size_t capacity() const { return m_capacity; }
+        void set_capacity(size_t capacity);
+
+        MessageView operator[](size_t i) const;
+        MessageView front() const { return (*this)[0]; }
+        MessageView back() const { return (*this)[m_size - 1]; }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, m_size); }
+
+        // Column accessors by logical index (0 = oldest)
+        Snowflake id_at(size_t i) const { return m_ids[pos(i)]; }
+        UserHandle author_at(size_t i) const { return m_authors[pos(i)]; }
+        std::string_view content_at(size_t i) const { return m_contents[pos(i)]; }
+        int64_t timestamp_at(size_t i) const { return m_timestamps[pos(i)]; }
+
+        // Index of the message with the given ID, or npos. O(log n); relies
+        // on history being ID-ordered like count_after.
+        size_t find(Snowflake id) const;
+
+        // Number of messages with an ID greater than `id` (e.g. unread after
+        // the last acknowledged message). Relies on history being ID-ordered.
+        size_t count_after(Snowflake id) const;
+
+        Snowflake guild_id() const { return m_guild_id; }
+
+        // True when the history was fetched from the server this session, so
+        // its newest message directly precedes the next gateway message.
+        // Histories restored from the state cache have a gap after them.
+        bool synced() const { return m_synced; }
+        void set_synced(bool synced) { m_synced = synced; }
+
+        // Changes with every edit and is never shared by two histories, so a
+        // view derived from one (like the Chat filter's match list) can tell
+        // from this alone whether it is stale
+        uint64_t version() const { return m_version; }
+
+        // LRU bookkeeping for State's history budget
+        uint64_t last_access() const { return m_last_access; }
+        void touch(uint64_t tick) { m_last_access = tick; }
+
+        const Arena::Stats& arena_stats() const { return m_arena.stats(); }
+        size_t memory_usage() const;
+
+    private:
+        size_t pos(size_t i) const { return (m_head + i) % m_slots; }
+
+        // Packs m into the arena and writes its fields at ring slot p
+        void store(size_t p, const Message& m);
+
+        // Copies content and attachments (Attachment or StoredAttachment)
+        // into one new arena block and points slot p's columns at it
+        template <typename A>
+        void pack(size_t p, std::string_view content, std::span<const A> attachments);
+
+        // Resizes every column to `slots`, linearizing the ring
+        void reslot(size_t slots);
+        static uint64_t next_version();
+
+        template <typename F>
+        void for_each_column(F&& f) {
+            f(m_ids);
+            f(m_authors);
+            f(m_reply_to);
+            f(m_pages);
+            f(m_contents);
+            f(m_timestamps);
+            f(m_attachments);
+        }
+
+        Arena m_arena;
+
+        std::vector<Snowflake> m_ids;
+        std::vector<UserHandle> m_authors;
+        std::vector<Snowflake> m_reply_to;
+        std::vector<uint32_t> m_pages;
+        std::vector<std::string_view> m_contents;
+        std::vector<int64_t> m_timestamps;
+        std::vector<std::span<const StoredAttachment>> m_attachments;
+
+        size_t m_slots = 0; // Ring size shared by all columns
+        size_t m_head = 0;
+        size_t m_size = 0;
+        size_t m_capacity;
+        uint64_t m_last_access = 0;
+        Snowflake m_guild_id;
+        bool m_synced = false;
+        uint64_t m_version = next_version();
+    };
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace discord {
+
+    // Bounded lock-free multi-producer, single-consumer queue (Vyukov's
+    // ring with per-cell sequence numbers). Producers claim a slot with one
+    // CAS on the tail and publish it through the cell's sequence; the
+    // consumer owns the head and never contends with producers on the
+    // same cache line. Capacity must be a power of two.
+    template <typename T, size_t Capacity>
+    class MpscRing {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    public:
+        MpscRing() : m_cells(std::make_unique<Cell[]>(Capacity)) {
+            for (size_t i = 0; i < Capacity; ++i) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~MpscRing() {
+            T discard;
+            while (try_pop(discard)) {}
+        }
+
+        MpscRing(const MpscRing&) = delete;
+        MpscRing& operator=(const MpscRing&) = delete;
+
+        // Any thread. Returns false (leaving v untouched) if the ring is full.
+        bool try_push(T&& v) {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = m_cells[pos & (Capacity - 1)];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        ::new (cell.storage) T(std::move(v));
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Consumer thread only. Returns false if nothing is published yet.
+        bool try_pop(T& out) {
+            Cell& cell = m_cells[m_head & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(m_head + 1) < 0) return false;
+
+            T* item = std::launder(reinterpret_cast<T*>(cell.storage));
+            out = std::move(*item);
+            item->~T();
+            cell.sequence.store(m_head + Capacity, std::memory_order_release);
+            ++m_head;
+            return true;
+        }
+
+        // Consumer thread only. Approximate while producers are active.
+        size_t size_approx() const {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t head = m_head;
+            return tail > head ? tail - head : 0;
+        }
+
+        static constexpr size_t capacity() { return Capacity; }
+
+    private:
+        static constexpr size_t CACHE_LINE = 64;
+
+        struct Cell {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};
+        alignas(CACHE_LINE) size_t m_head = 0;
+    };
+
+}
@@ -0,0 +1,272 @@
+#include "search_index.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+namespace discord {
+
+    namespace {
+
+        constexpr uint32_t DEAD = UINT32_MAX;
+        constexpr size_t MIN_COMPACT = 4096; // Dead documents before compaction is considered
+
+        uint32_t content_hash(std::string_view content) {
+            return static_cast<uint32_t>(std::hash<std::string_view>{}(content));
+        }
+
+        bool starts_with_nocase(std::string_view s, std::string_view prefix) {
+            if (s.size() < prefix.size()) return false;
+            for (size_t i = 0; i < prefix.size(); ++i) {
+                unsigned char a = static_cast<unsigned char>(s[i]);
+                unsigned char b = static_cast<unsigned char>(prefix[i]);
+                if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+                if (b >= 'A' && b <= 'Z') b += 'a' - 'A';
+                if (a != b) return false;
+            }
+            return true;
+        }
+
+        // Intersection of two ascending lists of documents below `docs`.
+        // Gallops through `large` when it dwarfs `small`, so a rare word keeps
+        // a common one cheap; otherwise marks `large` in a bitmap and probes
+        // it, which avoids the mispredicted branches of a merge.
+        std::vector<uint32_t> intersect(std::span<const uint32_t> small, std::span<const uint32_t> large, size_t docs) {
+            std::vector<uint32_t> out;
+            if (large.size() > small.size() * 16) {
+                auto from = large.begin();
+                for (uint32_t d : small) {
+                    from = std::lower_bound(from, large.end(), d);
+                    if (from == large.end()) break;
+                    if (*from == d) out.push_back(d);
+                }
+                return out;
+            }
+            std::vector<uint64_t> bits((docs + 63) / 64);
+            for (uint32_t d : large) bits[d / 64] |= uint64_t(1) << (d % 64);
+            out.resize(small.size());
+            size_t n = 0;
+            for (uint32_t d : small) {
+                out[n] = d;
+                n += (bits[d / 64] >> (d % 64)) & 1;
+            }
+            out.resize(n);
+            return out;
+        }
+
+    }
+
+    void SearchIndex::add(Snowflake id, Snowflake channel_id, UserHandle author, std::string_view content) {
+        uint32_t hash = content_hash(content);
+        auto it = m_doc_by_id.find(id);
+        if (it != m_doc_by_id.end()) {
+            if (m_hashes[it->second] == hash) return;
+            kill(it->second);
+        }
+
+        uint32_t doc = static_cast<uint32_t>(m_ids.size());
+        m_ids.push_back(id);
+        m_channels.push_back(channel_id);
+        m_authors.push_back(author);
+        m_hashes.push_back(hash);
+        m_dead.push_back(false);
+        m_doc_by_id[id] = doc;
+
+        if (author.valid()) {
+            if (author.index >= m_author_seen.size()) m_author_seen.resize(author.index + 1);
+            if (!m_author_seen[author.index]) {
+                m_author_seen[author.index] = true;
+                m_author_list.push_back(author.index);
+            }
+        }
+
+        for_each_token(content, [&](std::string_view token) {
+            auto term = m_terms.find(token);
+            if (term == m_terms.end()) {
+                term = m_terms.emplace(std::string(token), static_cast<uint32_t>(m_postings.size())).first;
+                m_ordered_terms.emplace(term->first, term->second);
+                m_postings.emplace_back();
+            }
+            // Documents only ever get appended, so a repeated token in the
+            // same message shows up as the list's last entry
+            auto& postings = m_postings[term->second];
+            if (postings.empty() || postings.back() != doc) postings.push_back(doc);
+        });
+        maybe_compact();
+    }
+
+    void SearchIndex::update(Snowflake id, std::string_view content) {
+        auto it = m_doc_by_id.find(id);
+        if (it == m_doc_by_id.end()) return;
+        uint32_t doc = it->second;
+        add(id, m_channels[doc], m_authors[doc], content);
+    }
+
+    void SearchIndex::remove(std::span<const Snowflake> ids) {
+        for (Snowflake id : ids) {
+            auto it = m_doc_by_id.find(id);
+            if (it == m_doc_by_id.end()) continue;
+            kill(it->second);
+            m_doc_by_id.erase(it);
+        }
+        maybe_compact();
+    }
+
+    void SearchIndex::kill(uint32_t doc) {
+        if (m_dead[doc]) return;
+        m_dead[doc] = true;
+        ++m_dead_count;
+    }
+
+    void SearchIndex::maybe_compact() {
+        if (m_dead_count >= MIN_COMPACT && m_dead_count * 4 >= m_ids.size()) compact();
+    }
+
+    void SearchIndex::compact() {
+        // Renumber live documents in order, so postings stay ascending
+        std::vector<uint32_t> remap(m_ids.size(), DEAD);
+        uint32_t live = 0;
+        for (uint32_t doc = 0; doc < m_ids.size(); ++doc) {
+            if (m_dead[doc]) continue;
+            remap[doc] = live;
+            m_ids[live] = m_ids[doc];
+            m_channels[live] = m_channels[doc];
+            m_authors[live] = m_authors[doc];
+            m_hashes[live] = m_hashes[doc];
+            ++live;
+        }
+        m_ids.resize(live);
+        m_channels.resize(live);
+        m_authors.resize(live);
+        m_hashes.resize(live);
+        m_dead.assign(live, false);
+        m_dead_count = 0;
+
+        for (auto& postings : m_postings) {
+            size_t kept = 0;
+            for (uint32_t doc : postings) {
+                if (remap[doc] != DEAD) postings[kept++] = remap[doc];
+            }
+            postings.resize(kept);
+        }
+        // Drop terms left without documents and pack the survivors' postings
+        // into fresh slots, so vocabulary churn doesn't grow the table
+        std::vector<std::vector<uint32_t>> packed;
+        packed.reserve(m_terms.size());
+        for (auto it = m_terms.begin(); it != m_terms.end();) {
+            auto& postings = m_postings[it->second];
+            if (postings.empty()) {
+                m_ordered_terms.erase(it->first);
+                it = m_terms.erase(it);
+                continue;
+            }
+            it->second = static_cast<uint32_t>(packed.size());
+            m_ordered_terms.find(it->first)->second = it->second;
+            packed.push_back(std::move(postings));
+            ++it;
+        }
+        m_postings = std::move(packed);
+        for (auto& [id, doc] : m_doc_by_id) doc = remap[doc];
+    }
+
+    std::span<const uint32_t> SearchIndex::match_word(std::string_view word, std::vector<uint32_t>& storage) const {
+        auto first = m_ordered_terms.lower_bound(word);
+        auto last = first;
+        size_t lists = 0;
+        while (last != m_ordered_terms.end() && last->first.starts_with(word)) {
+            ++last;
+            ++lists;
+        }
+        if (lists == 0) return {};
+        if (lists == 1) return m_postings[first->second];
+
+        // Union through a bitmap over all documents: linear in the postings
+        // plus one pass over n/64 words, however many tokens the prefix hits
+        std::vector<uint64_t> bits((m_ids.size() + 63) / 64);
+        for (auto it = first; it != last; ++it) {
+            for (uint32_t doc : m_postings[it->second]) bits[doc / 64] |= uint64_t(1) << (doc % 64);
+        }
+        for (size_t w = 0; w < bits.size(); ++w) {
+            for (uint64_t b = bits[w]; b; b &= b - 1) {
+                storage.push_back(static_cast<uint32_t>(w * 64 + std::countr_zero(b)));
+            }
+        }
+        return storage;
+    }
+
+    SearchIndex::Result SearchIndex::search(const Query& query) const {
+        Result result;
+
+        std::vector<std::string> words;
+        for_each_token(query.text, [&](std::string_view token) { words.emplace_back(token); });
+        // Text that is all punctuation matches nothing; only an empty text
+        // falls through to the filters-only scan below
+        if (!query.text.empty() && words.empty()) return result;
+
+        // Each word's matches, smallest first so intersections shrink fast
+        std::vector<std::vector<uint32_t>> storage(words.size());
+        std::vector<std::span<const uint32_t>> sets;
+        for (size_t i = 0; i < words.size(); ++i) {
+            auto set = match_word(words[i], storage[i]);
+            if (set.empty()) return result;
+            sets.push_back(set);
+        }
+        std::sort(sets.begin(), sets.end(), [](auto a, auto b) { return a.size() < b.size(); });
+
+        std::span<const uint32_t> candidates;
+        std::vector<uint32_t> intersection;
+        if (sets.size() == 1) {
+            candidates = sets[0];
+        } else if (sets.size() > 1) {
+            intersection = intersect(sets[0], sets[1], m_ids.size());
+            for (size_t i = 2; i < sets.size() && !intersection.empty(); ++i) intersection = intersect(intersection, sets[i], m_ids.size());
+            candidates = intersection;
+        }
+
+        std::vector<bool> authors;
+        if (!query.author.empty()) {
+            authors.resize(m_author_seen.size());
+            for (uint32_t a : m_author_list) {
+                if (starts_with_nocase(UserHandle{a}->username.view(), query.author)) authors[a] = true;
+            }
+        }
+
+        // Newest `limit` matches in a min-heap on message ID. Candidates are
+        // visited from the newest document down, and documents mostly arrive
+        // in ID order, so after the first few the heap rarely changes.
+        using Entry = std::pair<uint64_t, uint32_t>; // Message ID, document
+        std::vector<Entry> heap;
+        heap.reserve(query.limit + 1);
+        auto consider = [&](uint32_t doc) {
+            if (m_dead[doc]) return;
+            if (!query.channel_id.empty() && m_channels[doc] != query.channel_id) return;
+            if (!authors.empty()) {
+                UserHandle a = m_authors[doc];
+                if (!a.valid() || a.index >= authors.size() || !authors[a.index]) return;
+            }
+            ++result.total;
+            uint64_t id = m_ids[doc].value;
+            if (heap.size() < query.limit) {
+                heap.emplace_back(id, doc);
+                std::push_heap(heap.begin(), heap.end(), std::greater<>());
+            } else if (query.limit > 0 && id > heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+                heap.back() = {id, doc};
+                std::push_heap(heap.begin(), heap.end(), std::greater<>());
+            }
+        };
+
+        if (sets.empty()) {
+            // Filters only: every document is a candidate
+            for (uint32_t doc = static_cast<uint32_t>(m_ids.size()); doc-- > 0;) consider(doc);
+        } else {
+            for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) consider(*it);
+        }
+
+        std::sort_heap(heap.begin(), heap.end(), std::greater<>()); // Descending by ID
+        result.hits.reserve(heap.size());
+        for (const auto& [id, doc] : heap) result.hits.push_back({m_ids[doc], m_channels[doc], m_authors[doc]});
+        return result;
+    }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../discord/models.hpp"
+
+namespace discord {
+
+    // Inverted index over message content for local search. Content is split
+    // into tokens: runs of ASCII letters and digits, lowercased, plus bytes
+    // >= 0x80 kept as-is so non-Latin words are searchable without case
+    // folding. Each token maps to the ascending list of documents that
+    // contain it. Ingest looks tokens up in a hash table; an ordered view of
+    // the same terms lets a query word match every token it is a prefix of
+    // by walking one range.
+    //
+    // A document is one message version and only references the message (ID,
+    // channel, author); callers resolve hits to content. Edits index the new
+    // text under a new document, deletes mark documents dead, and once dead
+    // documents make up a quarter of the index the postings are compacted.
+    //
+    // Main-thread only, like the rest of State.
+    class SearchIndex {
+    public:
+        static constexpr size_t MAX_TOKEN = 32; // Longer tokens are truncated
+
+        struct Query {
+            std::string text;     // Every word must match, each as a prefix
+            std::string author;   // Username prefix, case-insensitive; empty for anyone
+            Snowflake channel_id; // Empty for every channel
+            size_t limit = 50;
+        };
+
+        struct Hit {
+            Snowflake id;
+            Snowflake channel_id;
+            UserHandle author;
+        };
+
+        struct Result {
+            std::vector<Hit> hits; // Newest first
+            size_t total = 0;      // Matches before the limit
+        };
+
+        // Indexes a message. A known ID is skipped if its content is
+        // unchanged and re-indexed otherwise (edits seen in a REST page).
+        void add(Snowflake id, Snowflake channel_id, UserHandle author, std::string_view content);
+        void add(const Message& m) { add(m.id, m.channel_id, m.author, m.content); }
+        void update(Snowflake id, std::string_view content);
+        void remove(std::span<const Snowflake> ids);
+
+        Result search(const Query& query) const;
+
+        size_t size() const { return m_doc_by_id.size(); } // Live messages
+
+        // Calls f(std::string_view) for each token of text, in order
+        template <typename F>
+        static void for_each_token(std::string_view text, F&& f) {
+            char token[MAX_TOKEN];
+            size_t len = 0;
+            for (size_t i = 0; i <= text.size(); ++i) {
+                unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+                bool upper = c >= 'A' && c <= 'Z';
+                if (upper || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) {
+                    if (len < MAX_TOKEN) token[len++] = static_cast<char>(upper ? c + ('a' - 'A') : c);
+                } else if (len > 0) {
+                    f(std::string_view(token, len));
+                    len = 0;
+                }
+            }
+        }
+
+    private:
+        void kill(uint32_t doc);
+        void maybe_compact();
+        void compact();
+        // Documents matching one query word, ascending. Points at a single
+        // postings list when possible; unions go to `storage`.
+        std::span<const uint32_t> match_word(std::string_view word, std::vector<uint32_t>& storage) const;
+
+        // Document columns, indexed by document number
+        std::vector<Snowflake> m_ids;
+        std::vector<Snowflake> m_channels;
+        std::vector<UserHandle> m_authors;
+        std::vector<uint32_t> m_hashes; // Content hash, to skip unchanged re-adds
+        std::vector<bool> m_dead;
+        size_t m_dead_count = 0;
+        std::unordered_map<Snowflake, uint32_t> m_doc_by_id; // Live document per message
+
+        struct TermHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        };
+        std::unordered_map<std::string, uint32_t, TermHash, std::equal_to<>> m_terms; // Token -> postings slot
+        std::map<std::string_view, uint32_t> m_ordered_terms; // Same terms, keys point into m_terms
+        std::vector<std::vector<uint32_t>> m_postings;
+
+        // Every author seen, for resolving the author filter by name
+        std::vector<uint32_t> m_author_list;
+        std::vector<bool> m_author_seen; // By UserHandle index
+    };
+
+}
@@ -0,0 +1,215 @@
+#include "state.hpp"
+
+#include <algorithm>
+
+namespace discord {
+
+    ChannelHistory& State::history(Snowflake channel_id) {
+        auto it = messages.find(channel_id);
+        if (it == messages.end()) {
+            it = messages.emplace(channel_id, ChannelHistory(history_per_channel)).first;
+            history_bytes += it->second.memory_usage();
+        }
+        return it->second;
+    }
+
+    void State::touch_channel(Snowflake channel_id) {
+        history(channel_id).touch(++access_tick);
+    }
+
+    Guild& State::upsert_guild(Guild&& g) {
+        // Channels inside GUILD_CREATE omit guild_id
+        for (auto& c : g.channels) {
+            c.guild_id = g.id;
+        }
+
+        auto it = guild_map.find(g.id);
+        if (it == guild_map.end()) {
+            guilds.push_back(std::make_unique<Guild>(std::move(g)));
+            Guild& stored = *guilds.back();
+            guild_map.emplace(stored.id, &stored);
+            reindex_channels(stored);
+            return stored;
+        }
+
+        Guild& stored = *it->second;
+        for (const auto& c : stored.channels) {
+            channel_map.erase(c.id);
+        }
+        stored = std::move(g);
+        reindex_channels(stored);
+        return stored;
+    }
+
+    void State::remove_guild(Snowflake guild_id) {
+        auto it = guild_map.find(guild_id);
+        if (it == guild_map.end()) return;
+        for (const auto& c : it->second->channels) {
+            channel_map.erase(c.id);
+            unread.remove(c.id);
+            auto h = messages.find(c.id);
+            if (h != messages.end()) {
+                history_bytes -= h->second.memory_usage();
+                messages.erase(h);
+            }
+            if (current_channel_id == c.id) current_channel_id = {};
+        }
+        if (current_guild_id == guild_id) current_guild_id = {};
+
+        guild_map.erase(it);
+        std::erase_if(guilds, [&](const std::unique_ptr<Guild>& g) { return g->id == guild_id; });
+    }
+
+    void State::reindex_channels(Guild& g) {
+        for (auto& c : g.channels) {
+            channel_map[c.id] = &c;
+            unread.attach(c.id, g.id, c.last_message_id);
+        }
+    }
+
+    void State::upsert_channel(Channel&& c) {
+        if (Channel* existing = get_channel(c.id)) {
+            *existing = std::move(c);
+            unread.attach(existing->id, existing->guild_id, existing->last_message_id);
+            return;
+        }
+        Guild* g = get_guild(c.guild_id);
+        if (!g) return;
+        g->channels.push_back(std::move(c));
+        reindex_channels(*g);
+    }
+
+    void State::remove_channel(Snowflake channel_id) {
+        Channel* c = get_channel(channel_id);
+        if (!c) return;
+        Guild* g = get_guild(c->guild_id);
+        channel_map.erase(channel_id);
+        unread.remove(channel_id);
+        if (g) {
+            std::erase_if(g->channels, [&](const Channel& ch) { return ch.id == channel_id; });
+            reindex_channels(*g);
+        }
+
+        auto h = messages.find(channel_id);
+        if (h != messages.end()) {
+            history_bytes -= h->second.memory_usage();
+            messages.erase(h);
+        }
+        if (current_channel_id == channel_id) current_channel_id = {};
+    }
+
+    void State::set_read_states(const std::vector<ReadState>& states) {
+        unread.clear();
+        for (const auto& rs : states) {
+            const Channel* c = get_channel(rs.id);
+            unread.set(rs.id, c ? c->guild_id : Snowflake{}, rs.last_message_id,
+                       {0, static_cast<uint32_t>(std::max(rs.mention_count, 0))});
+            if (c) unread.attach(c->id, c->guild_id, c->last_message_id);
+        }
+        for (const auto& [cid, h] : messages) recount_unread(cid, h);
+    }
+
+    bool State::mentions_self(const Message& m) const {
+        if (m.mention_everyone) return true;
+        if (self_id.empty()) return false;
+        return std::any_of(m.mentions.begin(), m.mentions.end(), [&](const User& u) { return u.id == self_id; });
+    }
+
+    void State::recount_unread(Snowflake channel_id, const ChannelHistory& h) {
+        Snowflake read = unread.last_read(channel_id);
+        if (read.empty() || h.empty() || read < h.front().id) return;
+        unread.recount(channel_id, static_cast<uint32_t>(h.count_after(read)));
+    }
+
+    void State::add_message(const Message& m) {
+        search.add(m);
+        ChannelHistory& h = history(m.channel_id);
+        // History stays ID-ordered. Anything not newer than the last message
+        // is already there (delivered by both REST and the gateway).
+        if (!h.empty() && m.id <= h.back().id) return;
+        size_t before = h.memory_usage();
+        h.append(m);
+        history_bytes = history_bytes - before + h.memory_usage();
+        if (m.channel_id == current_channel_id) h.touch(++access_tick);
+        enforce_history_budget();
+    }
+
+    bool State::update_message(const MessageUpdateEvent& update) {
+        if (update.content) search.update(update.id, update.content->view());
+        auto it = messages.find(update.channel_id);
+        if (it == messages.end()) return false;
+        ChannelHistory& h = it->second;
+        size_t index = h.find(update.id);
+        if (index == ChannelHistory::npos) return false;
+
+        size_t before = h.memory_usage();
+        h.patch(index, update.content, update.attachments);
+        history_bytes = history_bytes - before + h.memory_usage();
+
+        if (update.id == reply_msg_id && update.content) reply_content = update.content->str();
+        return true;
+    }
+
+    size_t State::delete_messages(Snowflake channel_id, std::span<const Snowflake> ids) {
+        search.remove(ids);
+        auto it = messages.find(channel_id);
+        if (it == messages.end()) return 0;
+        ChannelHistory& h = it->second;
+
+        size_t before = h.memory_usage();
+        size_t removed = h.erase(ids);
+        history_bytes = history_bytes - before + h.memory_usage();
+
+        if (!reply_msg_id.empty() && std::find(ids.begin(), ids.end(), reply_msg_id) != ids.end()) {
+            reply_msg_id = {};
+            reply_username.clear();
+            reply_content.clear();
+            reply_guild_id = {};
+        }
+        return removed;
+    }
+
+    void State::set_history(Snowflake channel_id, const std::vector<Message>& msgs, bool synced) {
+        for (const auto& m : msgs) search.add(m);
+        ChannelHistory& h = history(channel_id);
+        history_bytes -= h.memory_usage();
+        h.clear();
+        h.set_capacity(history_per_channel); // Drop any room scrollback added
+        h.assign(msgs);
+        h.set_synced(synced);
+        history_bytes += h.memory_usage();
+        recount_unread(channel_id, h);
+        h.touch(++access_tick);
+        enforce_history_budget();
+    }
+
+    void State::prepend_history(Snowflake channel_id, const std::vector<Message>& msgs) {
+        for (const auto& m : msgs) search.add(m);
+        ChannelHistory& h = history(channel_id);
+        size_t before = h.memory_usage();
+        if (h.size() + msgs.size() > h.capacity()) h.set_capacity(h.size() + msgs.size());
+        for (auto it = msgs.rbegin(); it != msgs.rend(); ++it) {
+            if (h.empty() || it->id < h.front().id) h.prepend(*it);
+        }
+        history_bytes = history_bytes - before + h.memory_usage();
+        h.touch(++access_tick);
+        enforce_history_budget();
+    }
+
+    void State::enforce_history_budget() {
+        while (history_bytes > history_budget_bytes && messages.size() > 1) {
+            auto coldest = messages.end();
+            for (auto it = messages.begin(); it != messages.end(); ++it) {
+                if (it->first == current_channel_id) continue;
+                if (coldest == messages.end() || it->second.last_access() < coldest->second.last_access()) {
+                    coldest = it;
+                }
+            }
+            if (coldest == messages.end()) break;
+
+            history_bytes -= coldest->second.memory_usage();
+            messages.erase(coldest);
+        }
+    }
+
+}
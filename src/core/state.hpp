@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include "../discord/models.hpp"
+#include "message_store.hpp"
+#include "search_index.hpp"
+#include "unread_tracker.hpp"
+
+namespace discord {
+
+    // A search hit resolved for display
+    struct SearchResult {
+        Snowflake id;
+        Snowflake channel_id;
+        Snowflake guild_id;
+        std::string channel;
+        std::string author;
+        std::string content;
+        int64_t timestamp = 0;
+    };
+
+    // Everything the UI renders. Only the main thread reads or writes it;
+    // other threads hand their results over as main-thread tasks.
+    struct State {
+        Snowflake current_guild_id;
+        Snowflake current_channel_id;
+        std::string channel_error; // Error message if channel fails to load
+        
+        // Reply state
+        Snowflake reply_msg_id;
+        std::string reply_username;
+        std::string reply_content;
+        Snowflake reply_guild_id;
+        
+        // Attachment state
+        std::string attached_file_path;
+        
+        // Guilds in display order. Each one lives in its own heap slot, so
+        // the pointers in guild_map and channel_map survive other guilds
+        // being added; only upsert_guild() on the same ID replaces them.
+        std::vector<std::unique_ptr<Guild>> guilds;
+        std::unordered_map<Snowflake, Guild*> guild_map;
+        std::unordered_map<Snowflake, Channel*> channel_map; // channel_id -> channel, across all guilds
+        
+        Snowflake self_id; // The logged-in account, from READY
+        UnreadTracker unread; // Read positions with unread and mention counts
+        std::unordered_map<Snowflake, ChannelHistory> messages; // channel_id -> messages
+        // Message authors are interned in UserStore::global(); messages hold UserHandles
+
+        // History limits. Each channel keeps at most history_per_channel
+        // messages; scrollback raises a channel's cap to fit the pages it
+        // prepends, and set_history() puts it back. Once all histories
+        // together exceed history_budget_bytes the least recently used
+        // channels are dropped and refetched over REST when opened again.
+        size_t history_per_channel = ChannelHistory::DEFAULT_CAPACITY;
+        size_t history_budget_bytes = 64 * 1024 * 1024;
+        size_t history_bytes = 0; // Maintained by the history helpers below
+        uint64_t access_tick = 0;
+
+        // Every message seen this session, including ones since evicted from
+        // the histories. Kept current by the history helpers below.
+        SearchIndex search;
+        std::vector<SearchResult> search_results;
+        size_t search_total = 0;
+        double search_ms = 0;
+
+        // Helpers
+        Guild* get_guild(Snowflake id) {
+            auto it = guild_map.find(id);
+            if (it != guild_map.end()) return it->second;
+            return nullptr;
+        }
+
+        const Guild* get_guild(Snowflake id) const {
+            auto it = guild_map.find(id);
+            return it != guild_map.end() ? it->second : nullptr;
+        }
+
+        Channel* get_channel(Snowflake channel_id) {
+            auto it = channel_map.find(channel_id);
+            return it != channel_map.end() ? it->second : nullptr;
+        }
+
+        const Channel* get_channel(Snowflake channel_id) const {
+            auto it = channel_map.find(channel_id);
+            return it != channel_map.end() ? it->second : nullptr;
+        }
+
+        // Adds a guild, or replaces the stored one with the same ID in place
+        // (keeping its display position). Only that guild's channels are
+        // reindexed.
+        Guild& upsert_guild(Guild&& g);
+        // Drops a guild with its channels and their histories
+        void remove_guild(Snowflake guild_id);
+        // Refreshes channel_map for one guild after its channel list changed
+        void reindex_channels(Guild& g);
+        // CHANNEL_CREATE/UPDATE/DELETE. Channels outside known guilds (DMs)
+        // are ignored.
+        void upsert_channel(Channel&& c);
+        void remove_channel(Snowflake channel_id);
+
+        // Replaces every read position with READY's read_state entries
+        void set_read_states(const std::vector<ReadState>& states);
+        // Counts a channel's unread messages in its history, if the history
+        // reaches back to the read position
+        void recount_unread(Snowflake channel_id, const ChannelHistory& h);
+        // True if m pings the logged-in account directly or via @everyone
+        bool mentions_self(const Message& m) const;
+
+        // History helpers; these keep history_bytes and the LRU order current
+        ChannelHistory& history(Snowflake channel_id);
+        void touch_channel(Snowflake channel_id);
+        void add_message(const Message& m);
+        // Edits and deletes for cached channels. Messages that aren't cached
+        // are ignored; they arrive current when the channel is fetched.
+        bool update_message(const MessageUpdateEvent& update);
+        size_t delete_messages(Snowflake channel_id, std::span<const Snowflake> ids);
+        void set_history(Snowflake channel_id, const std::vector<Message>& msgs, bool synced = true);
+        // Adds older messages (oldest first) in front of the history,
+        // growing its capacity so scrollback isn't cut off by the ring
+        void prepend_history(Snowflake channel_id, const std::vector<Message>& msgs);
+        void enforce_history_budget();
+    };
+
+}
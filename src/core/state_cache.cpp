@@ -0,0 +1,251 @@
+#include "state_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "binary_io.hpp"
+#include "log.hpp"
+
+namespace discord {
+
+    namespace {
+
+        constexpr char MAGIC[8] = {'C', 'H', 'U', 'D', 'C', 'A', 'C', 'H'};
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t payload_size;
+            uint64_t checksum; // FNV-1a over the payload
+        };
+
+        void write_user(BinaryWriter& w, const User& u) {
+            w.id(u.id);
+            w.str(u.username);
+            w.str(u.discriminator);
+            w.str(u.avatar);
+        }
+
+        // Smallest record write_channel produces: four IDs, type and position,
+        // and the lengths of two empty strings
+        constexpr size_t MIN_CHANNEL_SIZE = 8 * 4 + 4 * 2 + 4 * 2;
+
+        void write_channel(BinaryWriter& w, const Channel& c) {
+            w.id(c.id);
+            w.pod(static_cast<int32_t>(c.type));
+            w.id(c.guild_id);
+            w.str(c.name);
+            w.pod(static_cast<int32_t>(c.position));
+            w.str(c.topic);
+            w.id(c.last_message_id);
+            w.id(c.parent_id);
+        }
+
+        Channel read_channel(BinaryReader& r) {
+            Channel c;
+            c.id = r.id();
+            c.type = r.pod<int32_t>();
+            c.guild_id = r.id();
+            c.name = SharedString(r.str());
+            c.position = r.pod<int32_t>();
+            c.topic = SharedString(r.str());
+            c.last_message_id = r.id();
+            c.parent_id = r.id();
+            return c;
+        }
+
+    }
+
+    bool save_state_cache(const std::string& path, const State& state, size_t messages_per_channel) {
+        BinaryWriter w;
+        w.id(state.current_guild_id);
+        w.id(state.current_channel_id);
+
+        // Authors of the cached messages, referenced by index below
+        std::vector<UserHandle> users;
+        std::unordered_map<uint32_t, uint32_t> user_index;
+        for (const auto& [cid, h] : state.messages) {
+            size_t first = h.size() > messages_per_channel ? h.size() - messages_per_channel : 0;
+            for (size_t i = first; i < h.size(); ++i) {
+                UserHandle a = h.author_at(i);
+                if (a.valid() && user_index.emplace(a.index, static_cast<uint32_t>(users.size())).second) {
+                    users.push_back(a);
+                }
+            }
+        }
+        w.pod(static_cast<uint32_t>(users.size()));
+        for (UserHandle u : users) write_user(w, *u);
+
+        w.pod(static_cast<uint32_t>(state.guilds.size()));
+        for (const auto& g : state.guilds) {
+            w.id(g->id);
+            w.str(g->name);
+            w.str(g->icon);
+            w.pod(static_cast<uint32_t>(g->channels.size()));
+            for (const auto& c : g->channels) write_channel(w, c);
+        }
+
+        w.pod(static_cast<uint32_t>(state.unread.channels().size()));
+        for (const auto& [cid, entry] : state.unread.channels()) {
+            w.id(cid);
+            w.id(entry.guild_id);
+            w.id(entry.last_read);
+            w.pod(entry.counts.unread);
+            w.pod(entry.counts.mentions);
+        }
+
+        w.pod(static_cast<uint32_t>(state.messages.size()));
+        for (const auto& [cid, h] : state.messages) {
+            size_t first = h.size() > messages_per_channel ? h.size() - messages_per_channel : 0;
+            w.id(cid);
+            w.id(h.guild_id());
+            w.pod(static_cast<uint32_t>(h.size() - first));
+            for (size_t i = first; i < h.size(); ++i) {
+                MessageView m = h[i];
+                w.id(m.id);
+                w.pod(m.author.valid() ? user_index[m.author.index] : UserHandle::NONE);
+                w.id(m.reply_to);
+                w.pod(m.timestamp);
+                w.str(m.content);
+                w.pod(static_cast<uint32_t>(m.attachments.size()));
+                for (const auto& a : m.attachments) {
+                    w.id(a.id);
+                    w.str(a.filename);
+                    w.str(a.url);
+                    w.str(a.proxy_url);
+                    w.str(a.content_type);
+                    w.pod(static_cast<int32_t>(a.width));
+                    w.pod(static_cast<int32_t>(a.height));
+                }
+            }
+        }
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = STATE_CACHE_VERSION;
+        header.payload_size = w.out.size();
+        header.checksum = fnv1a64(w.out.data(), w.out.size());
+
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                LOG_WARN("Cache", "Cannot write ", tmp);
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(w.out.data(), static_cast<std::streamsize>(w.out.size()));
+            if (!file) {
+                LOG_WARN("Cache", "Write failed for ", tmp);
+                return false;
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            LOG_WARN("Cache", "Cannot replace ", path);
+            return false;
+        }
+        return true;
+    }
+
+    bool load_state_cache(const std::string& path, State& state) {
+        MappedFile file(path);
+        if (!file.data()) return false;
+
+        Header header;
+        if (file.size() < sizeof(header)) return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != STATE_CACHE_VERSION) {
+            LOG_INFO("Cache", "Ignoring cache with a different format version");
+            return false;
+        }
+        const char* payload = file.data() + sizeof(header);
+        if (header.payload_size != file.size() - sizeof(header) ||
+            fnv1a64(payload, header.payload_size) != header.checksum) {
+            LOG_WARN("Cache", "Ignoring corrupt cache ", path);
+            return false;
+        }
+
+        BinaryReader r{payload, payload + header.payload_size};
+        Snowflake current_guild = r.id();
+        Snowflake current_channel = r.id();
+
+        std::vector<UserHandle> users(r.count(8 + 3 * 4));
+        for (auto& u : users) {
+            User user;
+            user.id = r.id();
+            user.username = SharedString(r.str());
+            user.discriminator = SharedString(r.str());
+            user.avatar = SharedString(r.str());
+            if (!r.ok) return false;
+            u = UserStore::global().intern_snapshot(std::move(user));
+        }
+
+        std::vector<Guild> guilds(r.count(8 + 2 * 4 + 4));
+        for (auto& g : guilds) {
+            g.id = r.id();
+            g.name = SharedString(r.str());
+            g.icon = SharedString(r.str());
+            g.channels.resize(r.count(MIN_CHANNEL_SIZE));
+            for (auto& c : g.channels) c = read_channel(r);
+        }
+
+        struct SavedReadState {
+            Snowflake channel_id;
+            Snowflake guild_id;
+            Snowflake last_read;
+            UnreadTracker::Counts counts;
+        };
+        std::vector<SavedReadState> read_states(r.count(8 * 3 + 4 * 2));
+        for (auto& rs : read_states) {
+            rs.channel_id = r.id();
+            rs.guild_id = r.id();
+            rs.last_read = r.id();
+            rs.counts.unread = r.pod<uint32_t>();
+            rs.counts.mentions = r.pod<uint32_t>();
+        }
+
+        std::vector<std::pair<Snowflake, std::vector<Message>>> histories(r.count(8 * 2 + 4));
+        for (auto& [cid, msgs] : histories) {
+            cid = r.id();
+            Snowflake guild_id = r.id();
+            msgs.resize(r.count(8 * 3 + 4 * 3));
+            for (auto& m : msgs) {
+                m.id = r.id();
+                m.channel_id = cid;
+                m.guild_id = guild_id;
+                uint32_t author = r.pod<uint32_t>();
+                if (author < users.size()) m.author = users[author];
+                Snowflake reply_to = r.id();
+                if (!reply_to.empty()) m.message_reference = MessageReference{reply_to, cid, guild_id};
+                m.timestamp = r.pod<int64_t>();
+                m.content = SharedString(r.str());
+                m.attachments.resize(r.count(8 + 4 * 4 + 4 * 2));
+                for (auto& a : m.attachments) {
+                    a.id = r.id();
+                    a.filename = SharedString(r.str());
+                    a.url = SharedString(r.str());
+                    a.proxy_url = SharedString(r.str());
+                    a.content_type = SharedString(r.str());
+                    a.width = r.pod<int32_t>();
+                    a.height = r.pod<int32_t>();
+                }
+            }
+        }
+        if (!r.ok) return false;
+
+        state.guilds.reserve(guilds.size());
+        for (auto& g : guilds) state.upsert_guild(std::move(g));
+        for (const auto& rs : read_states) state.unread.set(rs.channel_id, rs.guild_id, rs.last_read, rs.counts);
+        for (const auto& [cid, msgs] : histories) {
+            if (!msgs.empty()) state.set_history(cid, msgs, false);
+        }
+        state.current_guild_id = state.get_guild(current_guild) ? current_guild : Snowflake{};
+        state.current_channel_id = state.get_channel(current_channel) ? current_channel : Snowflake{};
+        return true;
+    }
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "state.hpp"
+
+namespace discord {
+
+    // On-disk snapshot of State used to paint the UI at startup, before the
+    // gateway has delivered READY: the guild and channel tree, read states
+    // with their unread and mention counts, the selected guild/channel and
+    // the newest messages of each cached channel (with their authors). The
+    // file is a versioned, checksummed binary blob that is memory-mapped for
+    // loading; a version or checksum mismatch simply means a cold start.
+    constexpr uint32_t STATE_CACHE_VERSION = 2;
+
+    // Fills an empty State from the cache file. Returns false (leaving
+    // state untouched) if the file is missing, stale or corrupt.
+    bool load_state_cache(const std::string& path, State& state);
+
+    // Writes state to path atomically (temp file + rename), keeping the
+    // newest messages_per_channel messages of each history.
+    bool save_state_cache(const std::string& path, const State& state, size_t messages_per_channel);
+
+}
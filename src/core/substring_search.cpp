@@ -0,0 +1,236 @@
+#include "substring_search.hpp"
+
+#include <bit>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace discord {
+
+    namespace {
+
+        inline char fold(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c; }
+
+        // Compares k bytes of s, folded as they are read, with a folded needle
+        inline bool equal_folded(const char* s, const char* needle, size_t k) {
+            for (size_t i = 0; i < k; ++i) {
+                if (fold(s[i]) != needle[i]) return false;
+            }
+            return true;
+        }
+
+        // Tries each start position from `from` on, one byte at a time
+        bool scan_scalar(const char* s, size_t n, const char* needle, size_t k, size_t from) {
+            for (size_t i = from; i + k <= n; ++i) {
+                if (fold(s[i]) == needle[0] && equal_folded(s + i + 1, needle + 1, k - 1)) return true;
+            }
+            return false;
+        }
+
+        // Bit b of `mask` marks start position base + b as a candidate whose
+        // first and last bytes already match; checks the bytes in between
+        template <typename Mask>
+        bool verify(Mask mask, const char* s, size_t base, const char* needle, size_t k) {
+            if (k <= 2) return mask != 0;
+            for (; mask; mask &= mask - 1) {
+                size_t i = base + std::countr_zero(mask);
+                if (equal_folded(s + i + 1, needle + 1, k - 2)) return true;
+            }
+            return false;
+        }
+
+        // Bit that folds c's case: for a lowercase letter, byte | 0x20 equals
+        // c exactly when the byte is c or its uppercase form; any other byte
+        // must match as-is
+        inline char case_bit(char c) { return c >= 'a' && c <= 'z' ? 0x20 : 0; }
+
+        // The vector kernels below test W start positions at a time: one load
+        // at i holds their first bytes, another at i + k - 1 their last bytes,
+        // and only positions where both match the needle get verified. Both
+        // loads stay inside s while i + W <= n - k + 1. The leftover positions
+        // are covered by one block ending exactly at the last position, with
+        // the bits it shares with the previous block masked off.
+
+#if defined(__x86_64__)
+        // Broadcast needle ends and their case bits
+        struct Probe16 {
+            __m128i first, last, first_case, last_case;
+        };
+        struct Probe32 {
+            __m256i first, last, first_case, last_case;
+        };
+
+        inline uint32_t candidates16(const char* s, size_t i, size_t k, const Probe16& p) {
+            __m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)), p.first_case);
+            __m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + k - 1)), p.last_case);
+            __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(a, p.first), _mm_cmpeq_epi8(b, p.last));
+            return static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        }
+
+        __attribute__((target("avx2"))) inline uint32_t candidates32(const char* s, size_t i, size_t k, const Probe32& p) {
+            __m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)), p.first_case);
+            __m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + k - 1)), p.last_case);
+            __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(a, p.first), _mm256_cmpeq_epi8(b, p.last));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        }
+#elif defined(__aarch64__)
+        struct Probe16 {
+            uint8x16_t first, last, first_case, last_case;
+        };
+
+        // NEON has no movemask; narrowing each byte to a nibble gives a
+        // 64-bit mask with four bits per position
+        inline uint64_t candidates16(const char* s, size_t i, size_t k, const Probe16& p) {
+            uint8x16_t a = vorrq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(s + i)), p.first_case);
+            uint8x16_t b = vorrq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(s + i + k - 1)), p.last_case);
+            uint8x16_t hit = vandq_u8(vceqq_u8(a, p.first), vceqq_u8(b, p.last));
+            uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(hit), 4);
+            return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x1111111111111111ull;
+        }
+#endif
+
+#if defined(__x86_64__)
+        bool contains_nocase_sse2(const char* s, size_t n, const char* needle, size_t k) {
+            const size_t positions = n - k + 1;
+            if (positions < 16) return scan_scalar(s, n, needle, k, 0);
+            const Probe16 p{_mm_set1_epi8(needle[0]), _mm_set1_epi8(needle[k - 1]),
+                            _mm_set1_epi8(case_bit(needle[0])), _mm_set1_epi8(case_bit(needle[k - 1]))};
+            size_t i = 0;
+            for (; i + 16 <= positions; i += 16) {
+                if (verify(candidates16(s, i, k, p), s, i, needle, k)) return true;
+            }
+            if (i == positions) return false;
+            size_t base = positions - 16;
+            uint32_t mask = candidates16(s, base, k, p) & (~0u << (i - base));
+            return verify(mask, s, base, needle, k);
+        }
+
+        __attribute__((target("avx2"))) bool contains_nocase_avx2(const char* s, size_t n, const char* needle, size_t k) {
+            const size_t positions = n - k + 1;
+            if (positions < 32) return contains_nocase_sse2(s, n, needle, k);
+            const Probe32 p{_mm256_set1_epi8(needle[0]), _mm256_set1_epi8(needle[k - 1]),
+                            _mm256_set1_epi8(case_bit(needle[0])), _mm256_set1_epi8(case_bit(needle[k - 1]))};
+            size_t i = 0;
+            for (; i + 32 <= positions; i += 32) {
+                if (verify(candidates32(s, i, k, p), s, i, needle, k)) return true;
+            }
+            if (i == positions) return false;
+            size_t base = positions - 32;
+            uint32_t mask = candidates32(s, base, k, p) & (~0u << (i - base));
+            return verify(mask, s, base, needle, k);
+        }
+#elif defined(__aarch64__)
+        bool contains_nocase_neon(const char* s, size_t n, const char* needle, size_t k) {
+            const size_t positions = n - k + 1;
+            if (positions < 16) return scan_scalar(s, n, needle, k, 0);
+            const Probe16 p{vdupq_n_u8(static_cast<uint8_t>(needle[0])), vdupq_n_u8(static_cast<uint8_t>(needle[k - 1])),
+                            vdupq_n_u8(static_cast<uint8_t>(case_bit(needle[0]))),
+                            vdupq_n_u8(static_cast<uint8_t>(case_bit(needle[k - 1])))};
+            auto check = [&](uint64_t mask, size_t base) {
+                if (k <= 2) return mask != 0;
+                for (; mask; mask &= mask - 1) {
+                    size_t at = base + std::countr_zero(mask) / 4;
+                    if (equal_folded(s + at + 1, needle + 1, k - 2)) return true;
+                }
+                return false;
+            };
+            size_t i = 0;
+            for (; i + 16 <= positions; i += 16) {
+                if (check(candidates16(s, i, k, p), i)) return true;
+            }
+            if (i == positions) return false;
+            size_t base = positions - 16;
+            return check(candidates16(s, base, k, p) & (~0ull << ((i - base) * 4)), base);
+        }
+#else
+        bool contains_nocase_scalar(const char* s, size_t n, const char* needle, size_t k) {
+            return scan_scalar(s, n, needle, k, 0);
+        }
+#endif
+
+        using Kernel = bool (*)(const char*, size_t, const char*, size_t);
+
+#if defined(__x86_64__)
+        // Most chat messages are under a hundred bytes, where the AVX2
+        // kernel's wider tail and entry cost lose to SSE2 (measured on a
+        // 100k-message channel); it only pays off on longer text
+        constexpr size_t AVX2_MIN_LENGTH = 128;
+
+        bool contains_nocase_x86(const char* s, size_t n, const char* needle, size_t k) {
+            if (n >= AVX2_MIN_LENGTH) return contains_nocase_avx2(s, n, needle, k);
+            return contains_nocase_sse2(s, n, needle, k);
+        }
+#endif
+
+        Kernel pick_kernel() {
+#if defined(__x86_64__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return contains_nocase_x86;
+            return contains_nocase_sse2;
+#elif defined(__aarch64__)
+            return contains_nocase_neon;
+#else
+            return contains_nocase_scalar;
+#endif
+        }
+
+        Kernel kernel() {
+            static const Kernel k = pick_kernel();
+            return k;
+        }
+
+    }
+
+    std::string fold_ascii(std::string_view s) {
+        std::string out(s);
+        for (char& c : out) c = fold(c);
+        return out;
+    }
+
+    bool contains_nocase(std::string_view haystack, std::string_view folded_needle) {
+        if (folded_needle.empty()) return true;
+        if (haystack.size() < folded_needle.size()) return false;
+        return kernel()(haystack.data(), haystack.size(), folded_needle.data(), folded_needle.size());
+    }
+
+    void filter_history(const ChannelHistory& history, std::string_view needle, std::vector<uint32_t>& out) {
+        out.clear();
+        std::string folded = fold_ascii(needle);
+        const size_t k = folded.size();
+        const Kernel scan = kernel();
+        for (size_t i = 0; i < history.size(); ++i) {
+            std::string_view content = history.content_at(i);
+            if (k == 0 || (content.size() >= k && scan(content.data(), content.size(), folded.data(), k))) {
+                out.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    const std::vector<uint32_t>& HistoryFilter::update(const ChannelHistory& history, std::string_view text) {
+        std::string needle = fold_ascii(text);
+        if (history.version() == m_version && needle == m_needle) return m_matches;
+
+        // Typing another character can only narrow the matches, so unless
+        // the history changed, only the previous matches need rechecking
+        if (history.version() == m_version && !m_needle.empty() && needle.starts_with(m_needle)) {
+            const Kernel scan = kernel();
+            size_t kept = 0;
+            for (uint32_t i : m_matches) {
+                std::string_view content = history.content_at(i);
+                if (content.size() >= needle.size() && scan(content.data(), content.size(), needle.data(), needle.size())) {
+                    m_matches[kept++] = i;
+                }
+            }
+            m_matches.resize(kept);
+        } else {
+            filter_history(history, needle, m_matches);
+        }
+        m_version = history.version();
+        m_needle = std::move(needle);
+        return m_matches;
+    }
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "message_store.hpp"
+
+namespace discord {
+
+    // Case-insensitive substring search for the Chat panel's filter box.
+    // Only ASCII letters fold; other bytes (including UTF-8 sequences) must
+    // match exactly. The kernel is picked once at startup: SSE2 (baseline on
+    // x86-64) with AVX2 for long text when the CPU has it, NEON on ARM64 and
+    // a scalar loop elsewhere.
+
+    // ASCII-lowercased copy of s, the form needles are passed in
+    std::string fold_ascii(std::string_view s);
+
+    // True if haystack contains needle, which must already be folded
+    bool contains_nocase(std::string_view haystack, std::string_view folded_needle);
+
+    // Indices (oldest first) of the messages whose content contains needle;
+    // an empty needle matches every message
+    void filter_history(const ChannelHistory& history, std::string_view needle, std::vector<uint32_t>& out);
+
+    // Match list behind the Chat panel's filter box, kept across frames.
+    // update() returns the cached list while neither the history nor the
+    // text changed, and when the text only grew (the user typed another
+    // character) it rechecks the previous matches instead of every message.
+    class HistoryFilter {
+    public:
+        const std::vector<uint32_t>& update(const ChannelHistory& history, std::string_view text);
+
+    private:
+        uint64_t m_version = 0; // ChannelHistory::version() the matches are for; 0 for none
+        std::string m_needle;   // Folded
+        std::vector<uint32_t> m_matches;
+    };
+
+}
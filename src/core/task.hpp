@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace discord {
+
+    // Main-thread scheduling class. Interactive tasks answer something the
+    // user just did (opening a channel, picking a file) and run first;
+    // Background covers gateway ingest and image uploads, which run within
+    // the per-frame budget and may carry over to later frames.
+    enum class TaskPriority {
+        Interactive,
+        Background,
+    };
+
+    // Move-only `void()` callable for the main-thread task queue. Unlike
+    // std::function it accepts lambdas that own move-only state, so a
+    // worker can hand parsed results to the main thread without copying.
+    // Callables up to INLINE_SIZE bytes are stored in place; bigger ones
+    // (e.g. a lambda owning a whole Message) get one heap allocation.
+    class Task {
+    public:
+        static constexpr size_t INLINE_SIZE = 48;
+
+        Task() = default;
+
+        template <typename F>
+            requires(!std::is_same_v<std::decay_t<F>, Task> && std::is_invocable_r_v<void, std::decay_t<F>&>)
+        Task(F&& f) {
+            using Fn = std::decay_t<F>;
+            if constexpr (fits_inline<Fn>) {
+                ::new (m_storage) Fn(std::forward<F>(f));
+                m_ops = &InlineOps<Fn>::ops;
+            } else {
+                *reinterpret_cast<Fn**>(m_storage) = new Fn(std::forward<F>(f));
+                m_ops = &HeapOps<Fn>::ops;
+            }
+        }
+
+        Task(Task&& other) noexcept { take(other); }
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() { reset(); }
+
+        explicit operator bool() const { return m_ops != nullptr; }
+        void operator()() { m_ops->call(m_storage); }
+
+    private:
+        struct Ops {
+            void (*call)(void* storage);
+            void (*move)(void* dst, void* src); // Leaves src destroyed
+            void (*destroy)(void* storage);
+        };
+
+        template <typename Fn>
+        static constexpr bool fits_inline = sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+                                            std::is_nothrow_move_constructible_v<Fn>;
+
+        template <typename Fn>
+        struct InlineOps {
+            static Fn* get(void* s) { return std::launder(reinterpret_cast<Fn*>(s)); }
+            static constexpr Ops ops = {
+                [](void* s) { (*get(s))(); },
+                [](void* dst, void* src) {
+                    ::new (dst) Fn(std::move(*get(src)));
+                    get(src)->~Fn();
+                },
+                [](void* s) { get(s)->~Fn(); },
+            };
+        };
+
+        template <typename Fn>
+        struct HeapOps {
+            static Fn*& get(void* s) { return *reinterpret_cast<Fn**>(s); }
+            static constexpr Ops ops = {
+                [](void* s) { (*get(s))(); },
+                [](void* dst, void* src) { *reinterpret_cast<Fn**>(dst) = get(src); },
+                [](void* s) { delete get(s); },
+            };
+        };
+
+        void take(Task& other) noexcept {
+            m_ops = other.m_ops;
+            if (m_ops) m_ops->move(m_storage, other.m_storage);
+            other.m_ops = nullptr;
+        }
+
+        void reset() noexcept {
+            if (m_ops) m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+
+        alignas(std::max_align_t) unsigned char m_storage[INLINE_SIZE];
+        const Ops* m_ops = nullptr;
+    };
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "../discord/snowflake.hpp"
+
+namespace discord {
+
+    // Unread and mention counts per channel, rolled up per guild. Each
+    // channel remembers the last message the account acknowledged; a new
+    // message after it bumps the channel and its guild, and acknowledging
+    // subtracts the channel's counts from the guild again. Every update is
+    // O(1) and nothing scans messages, so the Servers and Channels panels
+    // read the counts each frame for free.
+    //
+    // Counts are exact for messages seen this session. A channel whose read
+    // position is behind its last_message_id when it is attached counts as
+    // one unread message until a loaded history lets recount() fix it.
+    //
+    // Main-thread only, like the rest of State.
+    class UnreadTracker {
+    public:
+        struct Counts {
+            uint32_t unread = 0;
+            uint32_t mentions = 0;
+        };
+
+        struct Entry {
+            Snowflake guild_id; // Empty for DMs and channels not attached yet
+            Snowflake last_read;
+            Counts counts;
+        };
+
+        // Sets a channel's read position and counts (READY's read_state, the
+        // state cache), replacing what was there
+        void set(Snowflake channel_id, Snowflake guild_id, Snowflake last_read, Counts counts) {
+            Entry& e = m_channels[channel_id];
+            subtract(e);
+            e = {guild_id, last_read, counts};
+            add(e.guild_id, counts);
+        }
+
+        // Files a known channel under its guild and marks it unread if the
+        // server's newest message is past the read position. Channels without
+        // a read state are left alone.
+        void attach(Snowflake channel_id, Snowflake guild_id, Snowflake last_message_id) {
+            auto it = m_channels.find(channel_id);
+            if (it == m_channels.end()) return;
+            Entry& e = it->second;
+            if (e.guild_id != guild_id) {
+                subtract(e);
+                e.guild_id = guild_id;
+                add(e.guild_id, e.counts);
+            }
+            if (e.counts.unread == 0 && e.last_read < last_message_id) {
+                e.counts.unread = 1;
+                add(e.guild_id, {1, 0});
+            }
+        }
+
+        // A new message from someone else
+        void on_message(Snowflake channel_id, Snowflake guild_id, Snowflake id, bool mention) {
+            Entry& e = m_channels[channel_id];
+            if (e.guild_id.empty() && !guild_id.empty()) {
+                e.guild_id = guild_id;
+                add(e.guild_id, e.counts);
+            }
+            if (id <= e.last_read) return;
+            Counts delta{1, mention ? 1u : 0u};
+            e.counts.unread += delta.unread;
+            e.counts.mentions += delta.mentions;
+            add(e.guild_id, delta);
+        }
+
+        // Marks the channel read through message_id. Older acks are ignored.
+        void ack(Snowflake channel_id, Snowflake message_id) {
+            Entry& e = m_channels[channel_id];
+            if (message_id < e.last_read) return;
+            subtract(e);
+            e.last_read = message_id;
+            e.counts = {};
+        }
+
+        // Replaces the unread count with one taken from a loaded history
+        // that reaches back to the read position
+        void recount(Snowflake channel_id, uint32_t unread) {
+            auto it = m_channels.find(channel_id);
+            if (it == m_channels.end()) return;
+            Entry& e = it->second;
+            subtract(e);
+            e.counts.unread = unread;
+            add(e.guild_id, e.counts);
+        }
+
+        void remove(Snowflake channel_id) {
+            auto it = m_channels.find(channel_id);
+            if (it == m_channels.end()) return;
+            subtract(it->second);
+            m_channels.erase(it);
+        }
+
+        void clear() {
+            m_channels.clear();
+            m_guilds.clear();
+        }
+
+        Counts channel(Snowflake channel_id) const {
+            auto it = m_channels.find(channel_id);
+            return it != m_channels.end() ? it->second.counts : Counts{};
+        }
+
+        Counts guild(Snowflake guild_id) const {
+            auto it = m_guilds.find(guild_id);
+            return it != m_guilds.end() ? it->second : Counts{};
+        }
+
+        Snowflake last_read(Snowflake channel_id) const {
+            auto it = m_channels.find(channel_id);
+            return it != m_channels.end() ? it->second.last_read : Snowflake{};
+        }
+
+        const std::unordered_map<Snowflake, Entry>& channels() const { return m_channels; }
+
+    private:
+        void add(Snowflake guild_id, Counts c) {
+            if (guild_id.empty() || (c.unread == 0 && c.mentions == 0)) return;
+            Counts& g = m_guilds[guild_id];
+            g.unread += c.unread;
+            g.mentions += c.mentions;
+        }
+
+        void subtract(const Entry& e) {
+            if (e.guild_id.empty() || (e.counts.unread == 0 && e.counts.mentions == 0)) return;
+            Counts& g = m_guilds[e.guild_id];
+            g.unread -= e.counts.unread;
+            g.mentions -= e.counts.mentions;
+        }
+
+        std::unordered_map<Snowflake, Entry> m_channels;
+        std::unordered_map<Snowflake, Counts> m_guilds; // Sums over each guild's channels
+    };
+
+}
@@ -6,10 +6,11 @@
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
-#include <iostream>
 #include <thread>
 #include <chrono>
 
+#include "../core/log.hpp"
+
 namespace beast = boost::beast;
 namespace websocket = beast::websocket;
 namespace net = boost::asio;
@@ -54,12 +55,12 @@ void Gateway::connect(const std::string& token) {
             m_ws.handshake(host, target);
 
             m_connected = true;
-            std::cout << "[Gateway] Handshake complete and connected.\n";
+            LOG_INFO("Gateway", "Handshake complete and connected.");
 
             read_loop();
 
         } catch (const std::exception& e) {
-            std::cerr << "[Gateway] Connect error: " << e.what() << "\n";
+            LOG_ERROR("Gateway", "Connect error: ", e.what());
             m_connected = false;
         }
     }).detach();
@@ -93,7 +94,7 @@ void Gateway::read_loop() {
 
         } catch (const std::exception& e) {
             if (m_connected) {
-                std::cerr << "[Gateway] Read error: " << e.what() << "\n";
+                LOG_ERROR("Gateway", "Read error: ", e.what());
             }
             m_connected = false;
         }
@@ -115,7 +116,7 @@ void Gateway::handle_message(const std::string& msg) {
 
         case 10: { // HELLO
             int interval = payload["d"]["heartbeat_interval"];
-            std::cout << "[Gateway] Hello! Heartbeat interval: " << interval << "ms" << std::endl;
+            LOG_INFO("Gateway", "Hello! Heartbeat interval: ", interval, "ms");
             start_heartbeat(interval);
 
             json identify = {
@@ -136,13 +137,13 @@ void Gateway::handle_message(const std::string& msg) {
         }
 
         case 11: // HEARTBEAT_ACK
-            // std::cout << "[Gateway] Heartbeat ACK" << std::endl;
+            LOG_DEBUG("Gateway", "Heartbeat ACK");
             break;
 
         case 0: { // DISPATCH
             if (payload.contains("t") && payload.contains("d")) {
                 std::string event = payload["t"];
-                // std::cout << "[Gateway] Dispatch: " << event << std::endl;
+                LOG_DEBUG("Gateway", "Dispatch: ", event);
                 m_callback(event, payload["d"]);
             }
             break;
@@ -153,7 +154,7 @@ void Gateway::handle_message(const std::string& msg) {
         }
 
     } catch (const std::exception& e) {
-        std::cerr << "Parse error: " << e.what() << "\n";
+        LOG_ERROR("Gateway", "Parse error: ", e.what());
     }
 }
 
@@ -164,7 +165,7 @@ void Gateway::send_json(const json& j) {
         m_ws.write(net::buffer(j.dump()));
     } catch (const std::exception& e) {
         if (m_connected) {
-            std::cerr << "[Gateway] Send error: " << e.what() << "\n";
+            LOG_ERROR("Gateway", "Send error: ", e.what());
         }
     }
 }
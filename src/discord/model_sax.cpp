@@ -0,0 +1,331 @@
+#include "model_sax.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+namespace discord {
+
+    namespace {
+
+        // Wrapper so READY's "guilds" array goes through the same machinery
+        struct ReadyGuilds {
+            std::vector<Guild> guilds;
+        };
+
+    }
+
+    template <> struct Model<ReadyGuilds> {
+        static constexpr auto fields = std::make_tuple(
+            field("guilds", &ReadyGuilds::guilds));
+    };
+
+    namespace {
+
+        class ModelSax;
+
+        // Type-erased handlers for one kind of frame. ObjectOps<T> and
+        // ArrayOps<T> below generate a table per model from its field
+        // descriptors; `field` is the index from lookup(), -1 for array
+        // elements.
+        struct FrameOps {
+            int (*lookup)(std::string_view key);
+            void (*on_string)(void* target, int field, std::string& v);
+            void (*on_integer)(void* target, int field, int64_t v);
+            void (*on_boolean)(void* target, int field, bool v);
+            bool (*on_object)(void* target, int field, ModelSax& p);
+            bool (*on_array)(void* target, int field, ModelSax& p);
+            void (*on_child_done)(void* target, int field, bool complete, ModelSax& p);
+            uint64_t required_mask;
+        };
+
+        struct Frame {
+            const FrameOps* ops; // nullptr while skipping a subtree
+            void* target;
+            int field = -1;
+            uint64_t seen = 0;
+            uint32_t skip_depth = 0;
+        };
+
+        // Event handler for json::sax_parse. Keeps a stack of the model
+        // objects being filled; subtrees nobody asked for are skipped by
+        // depth counting without building anything.
+        class ModelSax {
+        public:
+            explicit ModelSax(Frame root, bool root_is_array) : m_root(root), m_root_is_array(root_is_array) {
+                m_stack.reserve(8);
+            }
+
+            bool null() { return value_done(false); }
+            bool number_float(json::number_float_t, const std::string&) { return value_done(false); }
+            bool binary(json::binary_t&) { return value_done(false); }
+
+            bool boolean(bool v) {
+                Frame* f = value_target();
+                if (f) f->ops->on_boolean(f->target, f->field, v);
+                return value_done(f != nullptr);
+            }
+
+            bool number_integer(json::number_integer_t v) { return integer(v); }
+            bool number_unsigned(json::number_unsigned_t v) { return integer(static_cast<int64_t>(v)); }
+
+            bool string(std::string& v) {
+                Frame* f = value_target();
+                if (f) f->ops->on_string(f->target, f->field, v);
+                return value_done(f != nullptr);
+            }
+
+            bool key(std::string& k) {
+                Frame& f = m_stack.back();
+                if (f.ops) f.field = f.ops->lookup(k);
+                return true;
+            }
+
+            bool start_object(std::size_t) {
+                if (m_stack.empty()) return push_root(false);
+                Frame* f = value_target();
+                if (f && f->ops->on_object(f->target, f->field, *this)) return true;
+                return skip();
+            }
+
+            bool start_array(std::size_t) {
+                if (m_stack.empty()) return push_root(true);
+                Frame* f = value_target();
+                if (f && f->ops->on_array(f->target, f->field, *this)) return true;
+                return skip();
+            }
+
+            bool end_object() { return end(); }
+            bool end_array() { return end(); }
+
+            bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+                return false;
+            }
+
+            // True once the root value closed with all required fields
+            bool complete() const { return m_root_complete; }
+
+            // Called from the generated ops and from codecs
+            template <typename T>
+            bool push_object(T& target);
+
+            template <typename T>
+            bool push_array(std::vector<T>& target);
+
+            // Authors are parsed into a scratch User and interned when their
+            // object closes. Frames point into the deque, so it must not
+            // relocate elements.
+            User& acquire_scratch_user() { return m_scratch_users.emplace_back(); }
+            User& scratch_user() { return m_scratch_users.back(); }
+            void release_scratch_user() { m_scratch_users.pop_back(); }
+
+        private:
+            // The frame that receives the current value, or nullptr if the
+            // value belongs to a skipped subtree or an unknown key
+            Frame* value_target() {
+                if (m_stack.empty()) return nullptr;
+                Frame& f = m_stack.back();
+                if (!f.ops || (f.field < 0 && f.ops->lookup)) return nullptr;
+                return &f;
+            }
+
+            bool integer(int64_t v) {
+                Frame* f = value_target();
+                if (f) f->ops->on_integer(f->target, f->field, v);
+                return value_done(f != nullptr);
+            }
+
+            bool value_done(bool consumed) {
+                if (m_stack.empty()) return false;
+                Frame& f = m_stack.back();
+                if (consumed && f.field >= 0) f.seen |= uint64_t{1} << f.field;
+                f.field = -1;
+                return true;
+            }
+
+            bool skip() {
+                if (m_stack.back().ops) {
+                    m_stack.push_back(Frame{nullptr, nullptr, -1, 0, 1});
+                } else {
+                    m_stack.back().skip_depth++;
+                }
+                return true;
+            }
+
+            bool push_root(bool is_array) {
+                if (is_array != m_root_is_array || m_matched_root) return false;
+                m_matched_root = true;
+                m_stack.push_back(m_root);
+                return true;
+            }
+
+            bool end() {
+                Frame& f = m_stack.back();
+                if (!f.ops) {
+                    if (--f.skip_depth > 0) return true;
+                    m_stack.pop_back();
+                    m_stack.back().field = -1;
+                    return true;
+                }
+
+                bool complete = (f.seen & f.ops->required_mask) == f.ops->required_mask;
+                m_stack.pop_back();
+                if (m_stack.empty()) {
+                    m_root_complete = complete;
+                    return true;
+                }
+
+                Frame& parent = m_stack.back();
+                parent.ops->on_child_done(parent.target, parent.field, complete, *this);
+                return value_done(complete);
+            }
+
+            Frame m_root;
+            bool m_root_is_array;
+            bool m_matched_root = false;
+            bool m_root_complete = false;
+            std::vector<Frame> m_stack;
+            std::deque<User> m_scratch_users;
+        };
+
+        template <typename F>
+        using codec_of = typename std::remove_cvref_t<F>::codec;
+
+        template <typename T>
+        struct ObjectOps {
+            static T& self(void* target) { return *static_cast<T*>(target); }
+
+            static int lookup(std::string_view key) {
+                return reflect::KeyTable<T>::lookup(key);
+            }
+
+            static void on_string(void* target, int field, std::string& v) {
+                reflect::visit_field<T>(field, [&](const auto& f) {
+                    codec_of<decltype(f)>::sax_string(self(target).*(f.member), v);
+                });
+            }
+
+            static void on_integer(void* target, int field, int64_t v) {
+                reflect::visit_field<T>(field, [&](const auto& f) {
+                    codec_of<decltype(f)>::sax_integer(self(target).*(f.member), v);
+                });
+            }
+
+            static void on_boolean(void* target, int field, bool v) {
+                reflect::visit_field<T>(field, [&](const auto& f) {
+                    codec_of<decltype(f)>::sax_boolean(self(target).*(f.member), v);
+                });
+            }
+
+            static bool on_object(void* target, int field, ModelSax& p) {
+                return reflect::visit_field<T>(field, [&](const auto& f) {
+                    return codec_of<decltype(f)>::sax_object(self(target).*(f.member), p);
+                });
+            }
+
+            static bool on_array(void* target, int field, ModelSax& p) {
+                return reflect::visit_field<T>(field, [&](const auto& f) {
+                    return codec_of<decltype(f)>::sax_array(self(target).*(f.member), p);
+                });
+            }
+
+            static void on_child_done(void* target, int field, bool complete, ModelSax& p) {
+                reflect::visit_field<T>(field, [&](const auto& f) {
+                    codec_of<decltype(f)>::sax_done(self(target).*(f.member), complete, p);
+                });
+            }
+
+            static constexpr FrameOps ops = {
+                lookup, on_string, on_integer, on_boolean, on_object, on_array, on_child_done,
+                reflect::KeyTable<T>::required_mask,
+            };
+        };
+
+        // Elements are appended as they start; objects that close without
+        // their required fields are dropped again.
+        template <typename T>
+        struct ArrayOps {
+            static std::vector<T>& self(void* target) { return *static_cast<std::vector<T>*>(target); }
+
+            static void on_string(void* target, int, std::string& v) {
+                if constexpr (!Reflected<T>) AutoCodec::sax_string(self(target).emplace_back(), v);
+            }
+
+            static void on_integer(void* target, int, int64_t v) {
+                if constexpr (!Reflected<T>) AutoCodec::sax_integer(self(target).emplace_back(), v);
+            }
+
+            static void on_boolean(void* target, int, bool v) {
+                if constexpr (!Reflected<T>) AutoCodec::sax_boolean(self(target).emplace_back(), v);
+            }
+
+            static bool on_object(void* target, int, ModelSax& p) {
+                if constexpr (Reflected<T>) return p.push_object(self(target).emplace_back());
+                else return false;
+            }
+
+            static bool on_array(void*, int, ModelSax&) { return false; }
+
+            static void on_child_done(void* target, int, bool complete, ModelSax&) {
+                if (!complete) self(target).pop_back();
+            }
+
+            static constexpr FrameOps ops = {
+                nullptr, on_string, on_integer, on_boolean, on_object, on_array, on_child_done, 0,
+            };
+        };
+
+        template <typename T>
+        bool ModelSax::push_object(T& target) {
+            m_stack.push_back(Frame{&ObjectOps<T>::ops, &target});
+            return true;
+        }
+
+        template <typename T>
+        bool ModelSax::push_array(std::vector<T>& target) {
+            m_stack.push_back(Frame{&ArrayOps<T>::ops, &target});
+            return true;
+        }
+
+        template <typename T>
+        bool parse_object(std::string_view text, T& out) {
+            ModelSax sax(Frame{&ObjectOps<T>::ops, &out}, false);
+            return json::sax_parse(text.begin(), text.end(), &sax) && sax.complete();
+        }
+
+        template <typename T>
+        bool parse_array(std::string_view text, std::vector<T>& out) {
+            ModelSax sax(Frame{&ArrayOps<T>::ops, &out}, true);
+            return json::sax_parse(text.begin(), text.end(), &sax) && sax.complete();
+        }
+
+    }
+
+    bool parse_user(std::string_view text, User& out) {
+        return parse_object(text, out);
+    }
+
+    bool parse_channel(std::string_view text, Channel& out) {
+        return parse_object(text, out);
+    }
+
+    bool parse_message(std::string_view text, Message& out) {
+        return parse_object(text, out);
+    }
+
+    bool parse_guild(std::string_view text, Guild& out) {
+        return parse_object(text, out);
+    }
+
+    bool parse_messages(std::string_view text, std::vector<Message>& out) {
+        return parse_array(text, out);
+    }
+
+    bool parse_ready_guilds(std::string_view text, std::vector<Guild>& out) {
+        ReadyGuilds ready;
+        if (!parse_object(text, ready)) return false;
+        out = std::move(ready.guilds);
+        return true;
+    }
+
+}
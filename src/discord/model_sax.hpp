@@ -0,0 +1,29 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "models.hpp"
+
+namespace discord {
+
+    // Single-pass deserializers that build model structs straight from JSON
+    // text through nlohmann's SAX interface, without materializing a json
+    // DOM first. The handlers are generated from the Model<T> field
+    // descriptors (see reflect.hpp), so they accept exactly what from_json
+    // does: unknown keys and nulls are skipped, message authors are
+    // interned into UserStore. Each returns false on malformed JSON or when
+    // a required field is missing.
+
+    bool parse_user(std::string_view text, User& out);
+    bool parse_channel(std::string_view text, Channel& out);
+    bool parse_message(std::string_view text, Message& out);
+    bool parse_guild(std::string_view text, Guild& out);
+
+    // A JSON array of messages, e.g. a GET /channels/{id}/messages response.
+    // Entries missing a required field are dropped.
+    bool parse_messages(std::string_view text, std::vector<Message>& out);
+
+    // The "guilds" array of a READY dispatch payload (the "d" object)
+    bool parse_ready_guilds(std::string_view text, std::vector<Guild>& out);
+
+}
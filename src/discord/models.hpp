@@ -2,41 +2,200 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
+#include "snowflake.hpp"
+#include "timestamp.hpp"
+#include "reflect.hpp"
 
 namespace discord {
 
     using json = nlohmann::json;
 
     struct User {
-        std::string id;
-        std::string username;
-        std::string discriminator;
-        std::string avatar;
-    };
-
-    inline void from_json(const json& j, User& u) {
-        j.at("id").get_to(u.id);
-        j.at("username").get_to(u.username);
-        if (j.contains("discriminator") && !j["discriminator"].is_null())
-            j.at("discriminator").get_to(u.discriminator);
-        if (j.contains("avatar") && !j["avatar"].is_null())
-            j.at("avatar").get_to(u.avatar);
-    }
+        Snowflake id;
+        SharedString username;
+        SharedString discriminator;
+        SharedString avatar;
+    };
+
+    template <> struct Model<User> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &User::id, Required),
+            field("username", &User::username, Required),
+            field("discriminator", &User::discriminator),
+            field("avatar", &User::avatar));
+    };
+
+    // Compact reference to an interned User. Messages hold one of these
+    // instead of a full User copy; dereferencing goes through UserStore.
+    struct UserHandle {
+        static constexpr uint32_t NONE = 0xFFFFFFFF;
+        uint32_t index = NONE;
+
+        bool valid() const { return index != NONE; }
+        const User& operator*() const;
+        const User* operator->() const { return &**this; }
+        bool operator==(const UserHandle&) const = default;
+    };
+
+    // Central table of every user seen in message payloads, one entry per
+    // user ID. Storage is chunked so entries never move: handles and
+    // references stay valid while new users are appended.
+    class UserStore {
+    public:
+        static UserStore& global() {
+            static UserStore store;
+            return store;
+        }
+
+        // Returns the handle for u.id, adding the user if it is new. Safe to
+        // call from worker threads: a changed profile for a known user is
+        // queued rather than written, because the UI thread reads entries
+        // without locking. apply_pending_updates() publishes the changes.
+        UserHandle intern(User&& u) { return find_or_add(std::move(u), true); }
+
+        // Like intern(), but a known user keeps the profile it has. For
+        // snapshots read back from disk, which may predate that profile.
+        UserHandle intern_snapshot(User&& u) { return find_or_add(std::move(u), false); }
+
+        UserHandle find(Snowflake id) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_index.find(id);
+            return it != m_index.end() ? UserHandle{it->second} : UserHandle{};
+        }
+
+        const User& get(UserHandle h) const {
+            static const User unknown{Snowflake{}, "unknown", "", ""};
+            if (!h.valid()) return unknown;
+            return m_chunks[h.index / CHUNK_SIZE][h.index % CHUNK_SIZE];
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_count;
+        }
+
+        // Writes queued profile changes; call from the thread that reads
+        // profiles (the main thread). Every message by the user sees them.
+        void apply_pending_updates() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& [index, u] : m_pending) {
+                User& existing = slot(index);
+                existing.username = std::move(u.username);
+                existing.discriminator = std::move(u.discriminator);
+                existing.avatar = std::move(u.avatar);
+            }
+            m_pending.clear();
+        }
+
+    private:
+        static constexpr uint32_t CHUNK_SIZE = 1024;
+        static constexpr uint32_t MAX_CHUNKS = 4096;
+
+        User& slot(uint32_t index) { return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+
+        UserHandle find_or_add(User&& u, bool update) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_index.find(u.id);
+            if (it != m_index.end()) {
+                const User& existing = slot(it->second);
+                if (update && (existing.username != u.username || existing.discriminator != u.discriminator || existing.avatar != u.avatar)) {
+                    m_pending.emplace_back(it->second, std::move(u));
+                }
+                return UserHandle{it->second};
+            }
+
+            uint32_t index = m_count;
+            if (index / CHUNK_SIZE >= MAX_CHUNKS) return UserHandle{};
+            auto& chunk = m_chunks[index / CHUNK_SIZE];
+            if (!chunk) chunk = std::make_unique<User[]>(CHUNK_SIZE);
+            chunk[index % CHUNK_SIZE] = std::move(u);
+            m_index.emplace(chunk[index % CHUNK_SIZE].id, index);
+            ++m_count;
+            return UserHandle{index};
+        }
+
+        std::array<std::unique_ptr<User[]>, MAX_CHUNKS> m_chunks;
+        std::unordered_map<Snowflake, uint32_t> m_index;
+        uint32_t m_count = 0;
+        std::vector<std::pair<uint32_t, User>> m_pending; // Profile changes awaiting apply_pending_updates()
+        mutable std::mutex m_mutex;
+    };
 
-    inline void to_json(json& j, const User& u) {
-        j = json{{"id", u.id}, {"username", u.username}, {"discriminator", u.discriminator}, {"avatar", u.avatar}};
+    inline const User& UserHandle::operator*() const {
+        return UserStore::global().get(*this);
     }
 
+    // Reads a User object and stores the interned handle
+    struct InternedUserCodec {
+        static void read(const json& j, UserHandle& out) {
+            out = UserStore::global().intern(j.get<User>());
+        }
+
+        static void write(json& j, const UserHandle& v) {
+            j = *v;
+        }
+
+        static bool empty(const UserHandle& v) { return !v.valid(); }
+
+        static void sax_string(UserHandle&, std::string&) {}
+        static void sax_integer(UserHandle&, int64_t) {}
+        static void sax_boolean(UserHandle&, bool) {}
+
+        template <typename Parser>
+        static bool sax_object(UserHandle&, Parser& p) {
+            return p.push_object(p.acquire_scratch_user());
+        }
+
+        template <typename Parser>
+        static bool sax_array(UserHandle&, Parser&) { return false; }
+
+        template <typename Parser>
+        static void sax_done(UserHandle& out, bool complete, Parser& p) {
+            if (complete) out = UserStore::global().intern(std::move(p.scratch_user()));
+            p.release_scratch_user();
+        }
+    };
+
+    // ISO-8601 string on the wire, epoch milliseconds in memory
+    struct TimestampCodec {
+        static void read(const json& j, int64_t& out) {
+            if (j.is_string()) out = parse_timestamp_ms(j.get_ref<const std::string&>());
+        }
+
+        static void write(json& j, const int64_t& v) {
+            j = format_timestamp_iso(v);
+        }
+
+        static bool empty(const int64_t& v) { return v == 0; }
+
+        static void sax_string(int64_t& out, std::string& v) { out = parse_timestamp_ms(v); }
+        static void sax_integer(int64_t&, int64_t) {}
+        static void sax_boolean(int64_t&, bool) {}
+
+        template <typename Parser>
+        static bool sax_object(int64_t&, Parser&) { return false; }
+
+        template <typename Parser>
+        static bool sax_array(int64_t&, Parser&) { return false; }
+
+        template <typename Parser>
+        static void sax_done(int64_t&, bool, Parser&) {}
+    };
+
     struct Channel {
-        std::string id;
-        int type;
-        std::string guild_id;
-        std::string name;
-        int position;
-        std::string topic;
-        std::string last_message_id;
-        std::string parent_id; // Category ID
+        Snowflake id;
+        int type = 0;
+        Snowflake guild_id;
+        SharedString name;
+        int position = 0;
+        SharedString topic;
+        Snowflake last_message_id;
+        Snowflake parent_id; // Category ID
 
         // Helper for partial updates
         void update_from(const Channel& other) {
@@ -47,120 +206,227 @@ namespace discord {
         }
     };
 
-    inline void to_json(json& j, const Channel& c) {
-        j = json{{"id", c.id}, {"type", c.type}, {"name", c.name}, {"position", c.position}, {"topic", c.topic}, {"last_message_id", c.last_message_id}, {"parent_id", c.parent_id}};
-        if (!c.guild_id.empty()) j["guild_id"] = c.guild_id;
-    }
-
-    inline void from_json(const json& j, Channel& c) {
-        j.at("id").get_to(c.id);
-        j.at("type").get_to(c.type);
-        if (j.contains("guild_id")) j.at("guild_id").get_to(c.guild_id);
-        if (j.contains("name")) j.at("name").get_to(c.name);
-        if (j.contains("position")) j.at("position").get_to(c.position);
-        if (j.contains("topic") && !j["topic"].is_null()) j.at("topic").get_to(c.topic);
-        if (j.contains("last_message_id") && !j["last_message_id"].is_null()) j.at("last_message_id").get_to(c.last_message_id);
-        if (j.contains("parent_id") && !j["parent_id"].is_null()) j.at("parent_id").get_to(c.parent_id);
-    }
+    template <> struct Model<Channel> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &Channel::id, Required),
+            field("type", &Channel::type, Required),
+            field("guild_id", &Channel::guild_id, OmitEmpty),
+            field("name", &Channel::name),
+            field("position", &Channel::position),
+            field("topic", &Channel::topic),
+            field("last_message_id", &Channel::last_message_id),
+            field("parent_id", &Channel::parent_id));
+    };
 
     struct MessageReference {
-        std::string message_id;
-        std::string channel_id;
-        std::string guild_id;
+        Snowflake message_id;
+        Snowflake channel_id;
+        Snowflake guild_id;
     };
 
-    inline void from_json(const json& j, MessageReference& mr) {
-        if (j.contains("message_id")) j.at("message_id").get_to(mr.message_id);
-        if (j.contains("channel_id")) j.at("channel_id").get_to(mr.channel_id);
-        if (j.contains("guild_id")) j.at("guild_id").get_to(mr.guild_id);
-    }
+    template <> struct Model<MessageReference> {
+        static constexpr auto fields = std::make_tuple(
+            field("message_id", &MessageReference::message_id),
+            field("channel_id", &MessageReference::channel_id),
+            field("guild_id", &MessageReference::guild_id, OmitEmpty));
+    };
 
     struct Attachment {
-        std::string id;
-        std::string filename;
-        std::string url;
-        std::string proxy_url;
+        Snowflake id;
+        SharedString filename;
+        SharedString url;
+        SharedString proxy_url;
         int width = 0;
         int height = 0;
-        std::string content_type;
+        SharedString content_type;
     };
 
-    inline void from_json(const json& j, Attachment& a) {
-        j.at("id").get_to(a.id);
-        j.at("filename").get_to(a.filename);
-        j.at("url").get_to(a.url);
-        if (j.contains("proxy_url")) j.at("proxy_url").get_to(a.proxy_url);
-        if (j.contains("width") && !j["width"].is_null()) j.at("width").get_to(a.width);
-        if (j.contains("height") && !j["height"].is_null()) j.at("height").get_to(a.height);
-        if (j.contains("content_type") && !j["content_type"].is_null()) j.at("content_type").get_to(a.content_type);
-    }
+    template <> struct Model<Attachment> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &Attachment::id, Required),
+            field("filename", &Attachment::filename, Required),
+            field("url", &Attachment::url, Required),
+            field("proxy_url", &Attachment::proxy_url),
+            field("width", &Attachment::width),
+            field("height", &Attachment::height),
+            field("content_type", &Attachment::content_type));
+    };
 
     struct Message {
-        std::string id;
-        std::string channel_id;
-        std::string guild_id;
-        User author;
-        std::string content;
-        std::string timestamp;
+        Snowflake id;
+        Snowflake channel_id;
+        Snowflake guild_id;
+        UserHandle author;
+        SharedString content;
+        int64_t timestamp = 0; // Milliseconds since the Unix epoch
         std::optional<MessageReference> message_reference;
         std::vector<Attachment> attachments;
-    };
+        std::vector<User> mentions; // Users pinged by the message
+        bool mention_everyone = false;
 
-    inline void from_json(const json& j, Message& m) {
-        j.at("id").get_to(m.id);
-        j.at("channel_id").get_to(m.channel_id);
-        if (j.contains("guild_id")) j.at("guild_id").get_to(m.guild_id);
-        j.at("author").get_to(m.author);
-        j.at("content").get_to(m.content);
-        if (j.contains("timestamp") && !j["timestamp"].is_null())
-            j.at("timestamp").get_to(m.timestamp);
-        if (j.contains("message_reference") && !j["message_reference"].is_null()) {
-            m.message_reference = j["message_reference"].get<MessageReference>();
-        }
-        if (j.contains("attachments") && j["attachments"].is_array()) {
-            m.attachments.clear();
-            for (const auto& a_json : j["attachments"]) {
-                m.attachments.push_back(a_json.get<Attachment>());
-            }
-        }
-    }
+        // Move-only: history pages travel from the parsing thread into State
+        // without a copy, and the compiler rejects any that would creep in.
+        Message() = default;
+        Message(Message&&) = default;
+        Message& operator=(Message&&) = default;
+        Message(const Message&) = delete;
+        Message& operator=(const Message&) = delete;
+    };
 
-    inline void to_json(json& j, const Message& m) {
-        j = json{{"id", m.id}, {"channel_id", m.channel_id}, {"author", m.author}, {"content", m.content}, {"timestamp", m.timestamp}};
-        if (!m.guild_id.empty()) j["guild_id"] = m.guild_id;
-    }
+    // Authors are interned into UserStore as they are parsed
+    template <> struct Model<Message> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &Message::id, Required),
+            field("channel_id", &Message::channel_id, Required),
+            field("guild_id", &Message::guild_id, OmitEmpty),
+            field<InternedUserCodec>("author", &Message::author, Required),
+            field("content", &Message::content, Required),
+            field<TimestampCodec>("timestamp", &Message::timestamp),
+            field("message_reference", &Message::message_reference, OmitEmpty),
+            field("attachments", &Message::attachments),
+            field("mentions", &Message::mentions, OmitEmpty),
+            field("mention_everyone", &Message::mention_everyone, OmitEmpty));
+    };
 
     struct Guild {
-        std::string id;
-        std::string name;
-        std::string icon;
+        Snowflake id;
+        SharedString name;
+        SharedString icon;
         std::vector<Channel> channels;
+        bool unavailable = false; // READY stub; the full guild follows in GUILD_CREATE
     };
 
-    inline void from_json(const json& j, Guild& g) {
-        j.at("id").get_to(g.id);
-        if (j.contains("name")) j.at("name").get_to(g.name);
-        if (j.contains("icon") && !j["icon"].is_null()) j.at("icon").get_to(g.icon);
-        if (j.contains("channels") && j["channels"].is_array()) {
-            g.channels.clear();
-            for (const auto& c_json : j["channels"]) {
-                g.channels.push_back(c_json.get<Channel>());
+    template <> struct Model<Guild> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &Guild::id, Required),
+            field("name", &Guild::name),
+            field("icon", &Guild::icon),
+            field("channels", &Guild::channels),
+            field("unavailable", &Guild::unavailable, OmitEmpty));
+    };
+
+    // Last message the account has acknowledged in a channel
+    struct ReadState {
+        Snowflake id; // Channel ID
+        Snowflake last_message_id;
+        int mention_count = 0;
+    };
+
+    template <> struct Model<ReadState> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &ReadState::id, Required),
+            field("last_message_id", &ReadState::last_message_id),
+            field("mention_count", &ReadState::mention_count));
+    };
+
+    // READY's read_state is {"entries": [...]} on current API versions and
+    // a bare array on older ones
+    struct ReadStateListCodec {
+        static void read(const json& j, std::vector<ReadState>& out) {
+            if (j.is_object()) {
+                auto it = j.find("entries");
+                if (it != j.end()) AutoCodec::read(*it, out);
+            } else {
+                AutoCodec::read(j, out);
             }
         }
-    }
 
-    inline void to_json(json& j, const Guild& g) {
-        j = json{{"id", g.id}, {"name", g.name}, {"icon", g.icon}, {"channels", g.channels}};
-    }
+        static void write(json& j, const std::vector<ReadState>& v) {
+            AutoCodec::write(j["entries"], v);
+        }
+
+        static bool empty(const std::vector<ReadState>& v) { return v.empty(); }
+
+        static void sax_string(std::vector<ReadState>&, std::string&) {}
+        static void sax_integer(std::vector<ReadState>&, int64_t) {}
+        static void sax_boolean(std::vector<ReadState>&, bool) {}
+
+        template <typename Parser>
+        static bool sax_object(std::vector<ReadState>&, Parser&) { return false; }
+
+        template <typename Parser>
+        static bool sax_array(std::vector<ReadState>& out, Parser& p) {
+            out.clear();
+            return p.push_array(out);
+        }
+
+        template <typename Parser>
+        static void sax_done(std::vector<ReadState>&, bool, Parser&) {}
+    };
+
+    // Dispatch payloads
+    struct ReadyEvent {
+        User user; // The logged-in account
+        std::vector<Guild> guilds;
+        std::vector<ReadState> read_states; // Not sent to bot accounts
+    };
+
+    template <> struct Model<ReadyEvent> {
+        static constexpr auto fields = std::make_tuple(
+            field("user", &ReadyEvent::user, Required),
+            field("guilds", &ReadyEvent::guilds),
+            field<ReadStateListCodec>("read_state", &ReadyEvent::read_states));
+    };
+
+    // MESSAGE_UPDATE carries only the fields that changed
+    struct MessageUpdateEvent {
+        Snowflake id;
+        Snowflake channel_id;
+        std::optional<SharedString> content;
+        std::optional<std::vector<Attachment>> attachments;
+    };
+
+    template <> struct Model<MessageUpdateEvent> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &MessageUpdateEvent::id, Required),
+            field("channel_id", &MessageUpdateEvent::channel_id, Required),
+            field("content", &MessageUpdateEvent::content),
+            field("attachments", &MessageUpdateEvent::attachments));
+    };
+
+    struct MessageDeleteEvent {
+        Snowflake id;
+        Snowflake channel_id;
+    };
+
+    template <> struct Model<MessageDeleteEvent> {
+        static constexpr auto fields = std::make_tuple(
+            field("id", &MessageDeleteEvent::id, Required),
+            field("channel_id", &MessageDeleteEvent::channel_id, Required));
+    };
+
+    struct MessageDeleteBulkEvent {
+        std::vector<Snowflake> ids;
+        Snowflake channel_id;
+    };
+
+    template <> struct Model<MessageDeleteBulkEvent> {
+        static constexpr auto fields = std::make_tuple(
+            field("ids", &MessageDeleteBulkEvent::ids, Required),
+            field("channel_id", &MessageDeleteBulkEvent::channel_id, Required));
+    };
+
+    // Sent to user accounts when a channel is read, here or on another device
+    struct MessageAckEvent {
+        Snowflake channel_id;
+        Snowflake message_id;
+    };
+
+    template <> struct Model<MessageAckEvent> {
+        static constexpr auto fields = std::make_tuple(
+            field("channel_id", &MessageAckEvent::channel_id, Required),
+            field("message_id", &MessageAckEvent::message_id, Required));
+    };
 
     // Gateway Payloads
     struct HelloPayload {
-        int heartbeat_interval;
+        int heartbeat_interval = 0;
     };
     
-    inline void from_json(const json& j, HelloPayload& p) {
-        j.at("heartbeat_interval").get_to(p.heartbeat_interval);
-    }
+    template <> struct Model<HelloPayload> {
+        static constexpr auto fields = std::make_tuple(
+            field("heartbeat_interval", &HelloPayload::heartbeat_interval, Required));
+    };
 
     struct IdentifyProperties {
         std::string os;
@@ -168,18 +434,24 @@ namespace discord {
         std::string device;
     };
 
-    inline void to_json(json& j, const IdentifyProperties& p) {
-        j = json{{"$os", p.os}, {"$browser", p.browser}, {"$device", p.device}};
-    }
+    template <> struct Model<IdentifyProperties> {
+        static constexpr auto fields = std::make_tuple(
+            field("$os", &IdentifyProperties::os),
+            field("$browser", &IdentifyProperties::browser),
+            field("$device", &IdentifyProperties::device));
+    };
 
     struct IdentifyPayload {
         std::string token;
-        int intents;
+        int intents = 0;
         IdentifyProperties properties;
     };
 
-    inline void to_json(json& j, const IdentifyPayload& p) {
-        j = json{{"token", p.token}, {"intents", p.intents}, {"properties", p.properties}};
-    }
+    template <> struct Model<IdentifyPayload> {
+        static constexpr auto fields = std::make_tuple(
+            field("token", &IdentifyPayload::token, Required),
+            field("intents", &IdentifyPayload::intents, Required),
+            field("properties", &IdentifyPayload::properties));
+    };
 
 }
@@ -0,0 +1,309 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "snowflake.hpp"
+#include "shared_string.hpp"
+
+namespace discord {
+
+    using json = nlohmann::json;
+
+    // Compile-time field descriptors for model structs.
+    //
+    // A model opts in by specializing Model<T> with a constexpr tuple of
+    // fields:
+    //
+    //     template <> struct Model<User> {
+    //         static constexpr auto fields = std::make_tuple(
+    //             field("id", &User::id, Required),
+    //             field("username", &User::username));
+    //     };
+    //
+    // from_json/to_json below and the SAX parsers in model_sax.hpp are then
+    // generated from the descriptors. Keys are looked up through a perfect
+    // hash table computed at compile time, nulls always mean "leave the
+    // default", and fields marked Required must be present.
+    template <typename T>
+    struct Model;
+
+    template <typename T>
+    concept Reflected = requires { Model<T>::fields; };
+
+    enum FieldFlags : uint8_t {
+        Optional = 0,
+        Required = 1 << 0,  // Missing key is an error
+        OmitEmpty = 1 << 1, // Not written by to_json when empty
+    };
+
+    // Default value conversions, chosen by member type. Fields needing a
+    // different wire format name their own codec (see TimestampCodec and
+    // InternedUserCodec in models.hpp). A codec provides static read/write
+    // for the json DOM, empty() for OmitEmpty, and sax_* hooks used by the
+    // single-pass parser: scalars are handed over directly, nested values
+    // push a new frame onto the parser.
+    struct AutoCodec {
+        template <typename M>
+        static void read(const json& j, M& out) {
+            if constexpr (is_optional<M>::value) {
+                read(j, out.emplace());
+            } else if constexpr (is_vector<M>::value) {
+                out.clear();
+                if (!j.is_array()) return;
+                out.reserve(j.size());
+                for (const auto& e : j) read(e, out.emplace_back());
+            } else {
+                j.get_to(out);
+            }
+        }
+
+        template <typename M>
+        static void write(json& j, const M& v) {
+            if constexpr (is_optional<M>::value) {
+                if (v) write(j, *v);
+                else j = nullptr;
+            } else if constexpr (is_vector<M>::value) {
+                j = json::array();
+                for (const auto& e : v) write(j.emplace_back(), e);
+            } else {
+                j = v;
+            }
+        }
+
+        template <typename M>
+        static bool empty(const M& v) {
+            if constexpr (is_optional<M>::value) return !v.has_value();
+            else if constexpr (std::is_arithmetic_v<M>) return v == M{};
+            else if constexpr (requires { v.empty(); }) return v.empty();
+            else return false;
+        }
+
+        // Optional scalars are engaged only when the inner type takes the
+        // value, so a mistyped key still leaves them empty
+        template <typename M>
+        static void sax_string(M& out, std::string& v) {
+            if constexpr (is_optional<M>::value) {
+                if constexpr (takes_string<typename M::value_type>) sax_string(out.emplace(), v);
+            } else if constexpr (std::is_same_v<M, std::string>) out = std::move(v);
+            else if constexpr (std::is_same_v<M, SharedString>) out = SharedString(v);
+            else if constexpr (std::is_same_v<M, Snowflake>) out = Snowflake::parse(v);
+        }
+
+        template <typename M>
+        static void sax_integer(M& out, int64_t v) {
+            if constexpr (is_optional<M>::value) {
+                if constexpr (takes_integer<typename M::value_type>) sax_integer(out.emplace(), v);
+            } else if constexpr (std::is_same_v<M, Snowflake>) out = Snowflake(static_cast<uint64_t>(v));
+            else if constexpr (std::is_arithmetic_v<M>) out = static_cast<M>(v);
+        }
+
+        template <typename M>
+        static void sax_boolean(M& out, bool v) {
+            if constexpr (is_optional<M>::value) {
+                if constexpr (std::is_same_v<typename M::value_type, bool>) out = v;
+            } else if constexpr (std::is_same_v<M, bool>) out = v;
+        }
+
+        template <typename M, typename Parser>
+        static bool sax_object(M& out, Parser& p) {
+            if constexpr (is_optional<M>::value) {
+                if constexpr (Reflected<typename M::value_type>) return p.push_object(out.emplace());
+                else return false;
+            } else if constexpr (Reflected<M>) {
+                return p.push_object(out);
+            } else {
+                return false;
+            }
+        }
+
+        template <typename M, typename Parser>
+        static bool sax_array(M& out, Parser& p) {
+            if constexpr (is_vector<M>::value) {
+                out.clear();
+                return p.push_array(out);
+            } else {
+                return false;
+            }
+        }
+
+        template <typename M, typename Parser>
+        static void sax_done(M&, bool, Parser&) {}
+
+    private:
+        template <typename M> struct is_optional : std::false_type {};
+        template <typename M> struct is_optional<std::optional<M>> : std::true_type {};
+        template <typename M> struct is_vector : std::false_type {};
+        template <typename M> struct is_vector<std::vector<M>> : std::true_type {};
+        template <typename M>
+        static constexpr bool takes_string = std::is_same_v<M, std::string> || std::is_same_v<M, SharedString> || std::is_same_v<M, Snowflake>;
+        template <typename M>
+        static constexpr bool takes_integer = std::is_same_v<M, Snowflake> || std::is_arithmetic_v<M>;
+    };
+
+    template <typename T, typename M, typename Codec>
+    struct FieldDescriptor {
+        using owner_type = T;
+        using member_type = M;
+        using codec = Codec;
+
+        std::string_view name;
+        M T::* member;
+        uint8_t flags;
+    };
+
+    template <typename Codec = AutoCodec, typename T, typename M>
+    constexpr FieldDescriptor<T, M, Codec> field(std::string_view name, M T::* member, uint8_t flags = Optional) {
+        return {name, member, flags};
+    }
+
+    namespace reflect {
+
+        constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+            uint32_t h = 2166136261u ^ seed;
+            for (char c : s) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 16777619u;
+            }
+            return h ^ (h >> 15);
+        }
+
+        template <typename T>
+        constexpr size_t field_count = std::tuple_size_v<std::remove_cv_t<decltype(Model<T>::fields)>>;
+
+        template <typename T, size_t I>
+        constexpr const auto& field_at() {
+            return std::get<I>(Model<T>::fields);
+        }
+
+        // String -> index lookup over a fixed constexpr array of names. The
+        // table size and hash seed are searched at compile time so every
+        // name lands in its own slot; a lookup is one hash, one load and one
+        // string compare, and unknown names come back as -1.
+        template <const auto& Names>
+        struct NameTable {
+            static constexpr size_t N = std::size(Names);
+            static_assert(N <= 127, "slot indices are int8_t");
+
+            struct Layout {
+                size_t size;
+                uint32_t seed;
+            };
+
+            static constexpr Layout layout = [] {
+                for (size_t size = 4; size <= 1024; size *= 2) {
+                    if (size < N * 2) continue;
+                    for (uint32_t seed = 0; seed < 4096; ++seed) {
+                        bool used[1024] = {};
+                        bool ok = true;
+                        for (size_t i = 0; i < N && ok; ++i) {
+                            size_t slot = hash(Names[i], seed) & (size - 1);
+                            ok = !used[slot];
+                            used[slot] = true;
+                        }
+                        if (ok) return Layout{size, seed};
+                    }
+                }
+                return Layout{0, 0};
+            }();
+            static_assert(layout.size != 0, "no perfect hash found for names");
+
+            static constexpr auto slots = [] {
+                std::array<int8_t, layout.size> s{};
+                for (auto& e : s) e = -1;
+                for (size_t i = 0; i < N; ++i) s[hash(Names[i], layout.seed) & (layout.size - 1)] = static_cast<int8_t>(i);
+                return s;
+            }();
+
+            static int lookup(std::string_view key) {
+                int i = slots[hash(key, layout.seed) & (layout.size - 1)];
+                return (i >= 0 && Names[i] == key) ? i : -1;
+            }
+        };
+
+        template <typename T>
+        inline constexpr auto field_names = []<size_t... I>(std::index_sequence<I...>) {
+            return std::array<std::string_view, field_count<T>>{field_at<T, I>().name...};
+        }(std::make_index_sequence<field_count<T>>{});
+
+        // Key -> field index lookup for T, plus the Required fields as a mask
+        template <typename T>
+        struct KeyTable : NameTable<field_names<T>> {
+            static constexpr size_t N = field_count<T>;
+            static_assert(N <= 64, "field bitmasks are 64 bits wide");
+
+            static constexpr const auto& names = field_names<T>;
+
+            static constexpr uint64_t required_mask = []<size_t... I>(std::index_sequence<I...>) {
+                return (uint64_t{0} | ... | ((field_at<T, I>().flags & Required) ? (uint64_t{1} << I) : 0));
+            }(std::make_index_sequence<N>{});
+        };
+
+        // Calls f(descriptor) for field number `index`, resolved at runtime
+        // through a jump table of per-field instantiations.
+        template <typename T, typename F>
+        decltype(auto) visit_field(size_t index, F&& f) {
+            using R = decltype(f(field_at<T, 0>()));
+            return [&]<size_t... I>(std::index_sequence<I...>) -> R {
+                using Fn = R (*)(F&);
+                static constexpr Fn table[] = {[](F& fn) -> R { return fn(field_at<T, I>()); }...};
+                return table[index](f);
+            }(std::make_index_sequence<field_count<T>>{});
+        }
+
+        template <typename T, typename F>
+        void for_each_field(F&& f) {
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                (f(field_at<T, I>()), ...);
+            }(std::make_index_sequence<field_count<T>>{});
+        }
+
+    }
+
+    // Single pass over the object's members; nulls and unknown keys are
+    // skipped. Throws like json::at() when a Required field is missing.
+    template <Reflected T>
+    void from_json(const json& j, T& out) {
+        using Table = reflect::KeyTable<T>;
+        if (!j.is_object()) {
+            throw json::type_error::create(302, "type must be object, but is " + std::string(j.type_name()), &j);
+        }
+
+        uint64_t seen = 0;
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            int index = Table::lookup(it.key());
+            if (index < 0 || it->is_null()) continue;
+            reflect::visit_field<T>(static_cast<size_t>(index), [&](const auto& f) {
+                using Codec = typename std::remove_cvref_t<decltype(f)>::codec;
+                Codec::read(*it, out.*(f.member));
+            });
+            seen |= uint64_t{1} << index;
+        }
+
+        if ((seen & Table::required_mask) != Table::required_mask) {
+            for (size_t i = 0; i < Table::N; ++i) {
+                if ((Table::required_mask >> i & 1) && !(seen >> i & 1)) {
+                    throw json::out_of_range::create(403, "key '" + std::string(Table::names[i]) + "' not found", &j);
+                }
+            }
+        }
+    }
+
+    template <Reflected T>
+    void to_json(json& j, const T& v) {
+        j = json::object();
+        reflect::for_each_field<T>([&](const auto& f) {
+            using Codec = typename std::remove_cvref_t<decltype(f)>::codec;
+            if ((f.flags & OmitEmpty) && Codec::empty(v.*(f.member))) return;
+            Codec::write(j[std::string(f.name)], v.*(f.member));
+        });
+    }
+
+}
@@ -20,6 +20,20 @@ namespace discord {
     }
 
     void Rest::perform_request(const std::string& endpoint, const std::string& method, const json& body, ResponseCallback callback) {
+        RawResponseCallback raw_callback;
+        if (callback) {
+            raw_callback = [callback](bool success, const std::string& raw) {
+                json response_json;
+                try {
+                    if (!raw.empty()) response_json = json::parse(raw);
+                } catch(...) {}
+                callback(success, response_json);
+            };
+        }
+        perform_request_raw(endpoint, method, body, raw_callback);
+    }
+
+    void Rest::perform_request_raw(const std::string& endpoint, const std::string& method, const json& body, RawResponseCallback callback) {
         std::string token = m_token;
         std::thread([endpoint, method, body, callback, token]() {
             CURL* curl = curl_easy_init();
@@ -54,11 +68,7 @@ namespace discord {
                 bool success = (res == CURLE_OK) && (http_code >= 200 && http_code < 300);
                 
                 if (callback) {
-                    json response_json;
-                    try {
-                        if (!readBuffer.empty()) response_json = json::parse(readBuffer);
-                    } catch(...) {}
-                    callback(success, response_json);
+                    callback(success, readBuffer);
                 }
 
                 curl_slist_free_all(headers);
@@ -71,20 +81,22 @@ namespace discord {
         perform_request("/users/@me/guilds", "GET", json(), callback);
     }
 
-    void Rest::get_channels(const std::string& guild_id, ResponseCallback callback) {
-        perform_request("/guilds/" + guild_id + "/channels", "GET", json(), callback);
+    void Rest::get_channels(Snowflake guild_id, ResponseCallback callback) {
+        perform_request("/guilds/" + guild_id.str() + "/channels", "GET", json(), callback);
     }
 
-    void Rest::get_messages(const std::string& channel_id, ResponseCallback callback) {
-        perform_request("/channels/" + channel_id + "/messages?limit=50", "GET", json(), callback);
+    void Rest::get_messages(Snowflake channel_id, RawResponseCallback callback, Snowflake before) {
+        std::string path = "/channels/" + channel_id.str() + "/messages?limit=50";
+        if (!before.empty()) path += "&before=" + before.str();
+        perform_request_raw(path, "GET", json(), callback);
     }
 
-    void Rest::ack_message(const std::string& channel_id, const std::string& message_id) {
+    void Rest::ack_message(Snowflake channel_id, Snowflake message_id) {
         std::string token = m_token;
         std::thread([this, channel_id, message_id, token]() {
             CURL* curl = curl_easy_init();
             if (curl) {
-                std::string url = "https://discord.com/api/v9/channels/" + channel_id + "/messages/" + message_id + "/ack";
+                std::string url = "https://discord.com/api/v9/channels/" + channel_id.str() + "/messages/" + message_id.str() + "/ack";
                 struct curl_slist* headers = NULL;
                 headers = curl_slist_append(headers, ("Authorization: " + token).c_str());
                 headers = curl_slist_append(headers, "Content-Type: application/json");
@@ -101,7 +113,7 @@ namespace discord {
         }).detach();
     }
 
-    void Rest::send_message(const std::string& channel_id, const std::string& content, const std::string& guild_id, const std::string& reply_id, const std::string& file_path, ResponseCallback callback) {
+    void Rest::send_message(Snowflake channel_id, const std::string& content, Snowflake guild_id, Snowflake reply_id, const std::string& file_path, ResponseCallback callback) {
         std::string token = m_token;
         
         if (file_path.empty()) {
@@ -109,7 +121,7 @@ namespace discord {
                 CURL* curl = curl_easy_init();
                 if (curl) {
                     std::string readBuffer;
-                    std::string url = "https://discord.com/api/v9/channels/" + channel_id + "/messages";
+                    std::string url = "https://discord.com/api/v9/channels/" + channel_id.str() + "/messages";
                     struct curl_slist* headers = NULL;
                     headers = curl_slist_append(headers, ("Authorization: " + token).c_str());
                     headers = curl_slist_append(headers, "Content-Type: application/json");
@@ -153,7 +165,7 @@ namespace discord {
                         CURL* curl = curl_easy_init();
                         if (curl) {
                             std::string readBuffer;
-                            std::string url = "https://discord.com/api/v9/channels/" + channel_id + "/messages";
+                            std::string url = "https://discord.com/api/v9/channels/" + channel_id.str() + "/messages";
                             struct curl_slist* headers = NULL;
                             headers = curl_slist_append(headers, ("Authorization: " + token).c_str());
                             headers = curl_slist_append(headers, "Content-Type: application/json");
@@ -195,13 +207,13 @@ namespace discord {
         }
     }
 
-    void Rest::get_upload_url(const std::string& channel_id, const std::string& file_path, std::function<void(bool, UploadInfo)> callback) {
+    void Rest::get_upload_url(Snowflake channel_id, const std::string& file_path, std::function<void(bool, UploadInfo)> callback) {
         std::string token = m_token;
         std::thread([this, channel_id, file_path, callback, token]() {
             CURL* curl = curl_easy_init();
             if (curl) {
                 std::string readBuffer;
-                std::string url = "https://discord.com/api/v9/channels/" + channel_id + "/attachments";
+                std::string url = "https://discord.com/api/v9/channels/" + channel_id.str() + "/attachments";
                 struct curl_slist* headers = NULL;
                 headers = curl_slist_append(headers, ("Authorization: " + token).c_str());
                 headers = curl_slist_append(headers, "Content-Type: application/json");
@@ -5,6 +5,7 @@
 #include <vector>
 #include <nlohmann/json.hpp>
 #include <curl/curl.h>
+#include "snowflake.hpp"
 
 namespace discord {
 
@@ -16,12 +17,15 @@ namespace discord {
         ~Rest();
 
         using ResponseCallback = std::function<void(bool success, const json& data)>;
+        // Receives the unparsed response body, for callers with their own deserializer
+        using RawResponseCallback = std::function<void(bool success, const std::string& body)>;
 
         void get_guilds(ResponseCallback callback);
-        void get_channels(const std::string& guild_id, ResponseCallback callback);
-        void get_messages(const std::string& channel_id, ResponseCallback callback);
-        void send_message(const std::string& channel_id, const std::string& content, const std::string& guild_id = "", const std::string& reply_id = "", const std::string& file_path = "", ResponseCallback callback = nullptr);
-        void ack_message(const std::string& channel_id, const std::string& message_id);
+        void get_channels(Snowflake guild_id, ResponseCallback callback);
+        // The newest 50 messages, or the 50 before `before` when it is set
+        void get_messages(Snowflake channel_id, RawResponseCallback callback, Snowflake before = {});
+        void send_message(Snowflake channel_id, const std::string& content, Snowflake guild_id = {}, Snowflake reply_id = {}, const std::string& file_path = "", ResponseCallback callback = nullptr);
+        void ack_message(Snowflake channel_id, Snowflake message_id);
 
     private:
         struct UploadInfo {
@@ -30,10 +34,11 @@ namespace discord {
             std::string id;
         };
         
-        void get_upload_url(const std::string& channel_id, const std::string& file_path, std::function<void(bool, UploadInfo)> callback);
+        void get_upload_url(Snowflake channel_id, const std::string& file_path, std::function<void(bool, UploadInfo)> callback);
         void upload_to_gcs(const std::string& url, const std::string& file_path, std::function<void(bool)> callback);
         static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
         void perform_request(const std::string& endpoint, const std::string& method, const json& body, ResponseCallback callback);
+        void perform_request_raw(const std::string& endpoint, const std::string& method, const json& body, RawResponseCallback callback);
 
         std::string m_token;
         CURL* m_curl;
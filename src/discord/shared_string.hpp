@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <nlohmann/json.hpp>
+
+namespace discord {
+
+    using json = nlohmann::json;
+
+    // Immutable string for model text fields. Up to INLINE_CAPACITY bytes
+    // live inside the object, which covers most chat lines, names and
+    // avatar hashes without touching the heap. Longer strings go into one
+    // refcounted heap block shared by every copy, so copying a SharedString
+    // never copies its characters. The data is always NUL-terminated.
+    class SharedString {
+    public:
+        static constexpr size_t INLINE_CAPACITY = sizeof(void*) * 6 - 2;
+
+        SharedString() noexcept { set_empty(); }
+        SharedString(std::string_view s) { assign(s); }
+        SharedString(const std::string& s) : SharedString(std::string_view(s)) {}
+        SharedString(const char* s) : SharedString(std::string_view(s)) {}
+
+        SharedString(const SharedString& other) noexcept {
+            std::memcpy(static_cast<void*>(this), &other, sizeof(SharedString));
+            if (is_heap()) block()->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        SharedString(SharedString&& other) noexcept {
+            std::memcpy(static_cast<void*>(this), &other, sizeof(SharedString));
+            other.set_empty();
+        }
+
+        SharedString& operator=(SharedString other) noexcept {
+            swap(other);
+            return *this;
+        }
+
+        ~SharedString() { release(); }
+
+        void swap(SharedString& other) noexcept {
+            alignas(SharedString) unsigned char tmp[sizeof(SharedString)];
+            std::memcpy(tmp, static_cast<const void*>(this), sizeof(SharedString));
+            std::memcpy(static_cast<void*>(this), &other, sizeof(SharedString));
+            std::memcpy(static_cast<void*>(&other), tmp, sizeof(SharedString));
+        }
+
+        const char* data() const noexcept { return is_heap() ? block()->data : m_buf; }
+        const char* c_str() const noexcept { return data(); }
+        size_t size() const noexcept { return is_heap() ? heap_size() : tag(); }
+        bool empty() const noexcept { return size() == 0; }
+
+        std::string_view view() const noexcept { return {data(), size()}; }
+        operator std::string_view() const noexcept { return view(); }
+        std::string str() const { return std::string(view()); }
+
+        bool starts_with(std::string_view prefix) const noexcept { return view().starts_with(prefix); }
+
+        // True if the characters live in a shared heap block
+        bool is_heap() const noexcept { return tag() == HEAP_TAG; }
+
+        friend bool operator==(const SharedString& a, const SharedString& b) noexcept { return a.view() == b.view(); }
+        friend bool operator==(const SharedString& a, std::string_view b) noexcept { return a.view() == b; }
+        friend std::strong_ordering operator<=>(const SharedString& a, const SharedString& b) noexcept {
+            return a.view() <=> b.view();
+        }
+
+    private:
+        static constexpr uint8_t HEAP_TAG = 0xFF;
+
+        struct Block {
+            std::atomic<uint32_t> refs;
+            char data[1];
+        };
+
+        // Layout: inline characters, or {Block*, size_t size} at the start;
+        // the last byte is the inline length or HEAP_TAG
+        static constexpr size_t TAG = sizeof(void*) * 6 - 1;
+
+        uint8_t tag() const noexcept { return static_cast<uint8_t>(m_buf[TAG]); }
+        void set_tag(uint8_t t) noexcept { m_buf[TAG] = static_cast<char>(t); }
+
+        Block* block() const noexcept {
+            Block* b;
+            std::memcpy(&b, m_buf, sizeof(b));
+            return b;
+        }
+
+        size_t heap_size() const noexcept {
+            size_t n;
+            std::memcpy(&n, m_buf + sizeof(Block*), sizeof(n));
+            return n;
+        }
+
+        void set_empty() noexcept {
+            m_buf[0] = '\0';
+            set_tag(0);
+        }
+
+        void assign(std::string_view s) {
+            if (s.size() <= INLINE_CAPACITY) {
+                std::memcpy(m_buf, s.data(), s.size());
+                m_buf[s.size()] = '\0';
+                set_tag(static_cast<uint8_t>(s.size()));
+                return;
+            }
+            void* mem = ::operator new(offsetof(Block, data) + s.size() + 1);
+            Block* b = ::new (mem) Block;
+            b->refs.store(1, std::memory_order_relaxed);
+            std::memcpy(b->data, s.data(), s.size());
+            b->data[s.size()] = '\0';
+            size_t n = s.size();
+            std::memcpy(m_buf, &b, sizeof(b));
+            std::memcpy(m_buf + sizeof(b), &n, sizeof(n));
+            set_tag(HEAP_TAG);
+        }
+
+        void release() noexcept {
+            if (!is_heap()) return;
+            Block* b = block();
+            if (b->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                b->~Block();
+                ::operator delete(b);
+            }
+        }
+
+        alignas(void*) char m_buf[TAG + 1];
+    };
+
+    static_assert(sizeof(SharedString) == 6 * sizeof(void*));
+
+    inline void from_json(const json& j, SharedString& s) {
+        s = SharedString(j.get_ref<const std::string&>());
+    }
+
+    inline void to_json(json& j, const SharedString& s) {
+        j = s.view();
+    }
+
+}
+
+template <>
+struct std::hash<discord::SharedString> {
+    size_t operator()(const discord::SharedString& s) const noexcept {
+        return std::hash<std::string_view>{}(s.view());
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <functional>
+#include <nlohmann/json.hpp>
+
+namespace discord {
+
+    using json = nlohmann::json;
+
+    // Discord IDs are 64-bit integers serialized as decimal strings.
+    // A zero value means "no ID" (missing or null in the payload).
+    struct Snowflake {
+        static constexpr uint64_t DISCORD_EPOCH_MS = 1420070400000ULL;
+
+        uint64_t value = 0;
+
+        constexpr Snowflake() = default;
+        constexpr explicit Snowflake(uint64_t v) : value(v) {}
+
+        // Returns an empty Snowflake if the string is not a valid decimal ID.
+        static Snowflake parse(std::string_view s) {
+            uint64_t v = 0;
+            auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+            if (ec != std::errc() || ptr != s.data() + s.size()) return Snowflake{};
+            return Snowflake(v);
+        }
+
+        std::string str() const {
+            char buf[20];
+            auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+            return std::string(buf, ptr);
+        }
+
+        constexpr bool empty() const { return value == 0; }
+        constexpr explicit operator bool() const { return value != 0; }
+
+        // Creation time in milliseconds since the Unix epoch
+        constexpr int64_t timestamp_ms() const {
+            return static_cast<int64_t>((value >> 22) + DISCORD_EPOCH_MS);
+        }
+
+        // Smallest snowflake that could have been created at the given time,
+        // useful as a `before`/`after` bound for time-based queries. Times
+        // before the Discord epoch clamp to 0.
+        static constexpr Snowflake from_timestamp_ms(int64_t ms) {
+            if (ms < static_cast<int64_t>(DISCORD_EPOCH_MS)) return Snowflake();
+            return Snowflake((static_cast<uint64_t>(ms) - DISCORD_EPOCH_MS) << 22);
+        }
+
+        constexpr auto operator<=>(const Snowflake&) const = default;
+    };
+
+    inline void from_json(const json& j, Snowflake& s) {
+        if (j.is_string()) s = Snowflake::parse(j.get_ref<const std::string&>());
+        else if (j.is_number_unsigned() || j.is_number_integer()) s = Snowflake(j.get<uint64_t>());
+        else s = Snowflake{};
+    }
+
+    inline void to_json(json& j, const Snowflake& s) {
+        if (s.empty()) j = nullptr;
+        else j = s.str();
+    }
+
+}
+
+template <>
+struct std::hash<discord::Snowflake> {
+    size_t operator()(const discord::Snowflake& s) const noexcept {
+        // Low bits are worker/increment and cluster poorly; mix before bucketing
+        uint64_t x = s.value;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+};
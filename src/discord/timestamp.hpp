@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace discord {
+
+    // Discord timestamps are ISO-8601 strings such as
+    // "2024-05-01T12:34:56.789000+00:00". Models keep them as milliseconds
+    // since the Unix epoch so sorting and range queries are integer compares.
+
+    namespace detail {
+
+        // Days since 1970-01-01 for a proleptic Gregorian date
+        constexpr int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+            y -= m <= 2;
+            const int64_t era = (y >= 0 ? y : y - 399) / 400;
+            const unsigned yoe = static_cast<unsigned>(y - era * 400);
+            const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+            const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + static_cast<int64_t>(doe) - 719468;
+        }
+
+        constexpr bool digits(std::string_view s, size_t pos, size_t count, int& out) {
+            if (pos + count > s.size()) return false;
+            int v = 0;
+            for (size_t i = pos; i < pos + count; ++i) {
+                unsigned d = static_cast<unsigned char>(s[i]) - '0';
+                if (d > 9) return false;
+                v = v * 10 + static_cast<int>(d);
+            }
+            out = v;
+            return true;
+        }
+
+    }
+
+    // Parses "YYYY-MM-DDTHH:MM:SS[.fraction][Z|+HH:MM|-HH:MM]".
+    // Returns 0 if the string is malformed.
+    constexpr int64_t parse_timestamp_ms(std::string_view s) {
+        if (s.size() < 19) return 0;
+        int year, month, day, hour, minute, second;
+        if (!detail::digits(s, 0, 4, year) || s[4] != '-' ||
+            !detail::digits(s, 5, 2, month) || s[7] != '-' ||
+            !detail::digits(s, 8, 2, day) || (s[10] != 'T' && s[10] != ' ') ||
+            !detail::digits(s, 11, 2, hour) || s[13] != ':' ||
+            !detail::digits(s, 14, 2, minute) || s[16] != ':' ||
+            !detail::digits(s, 17, 2, second)) {
+            return 0;
+        }
+        if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return 0;
+
+        size_t pos = 19;
+        int millis = 0;
+        if (pos < s.size() && s[pos] == '.') {
+            ++pos;
+            int scale = 100;
+            while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') {
+                millis += (s[pos] - '0') * scale;
+                scale /= 10;
+                ++pos;
+            }
+        }
+
+        int offset_minutes = 0;
+        if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+            int oh, om;
+            if (!detail::digits(s, pos + 1, 2, oh) || pos + 3 >= s.size() || s[pos + 3] != ':' ||
+                !detail::digits(s, pos + 4, 2, om)) {
+                return 0;
+            }
+            offset_minutes = (oh * 60 + om) * (s[pos] == '-' ? -1 : 1);
+        }
+
+        int64_t days = detail::days_from_civil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+        int64_t secs = days * 86400 + hour * 3600 + minute * 60 + second - offset_minutes * 60;
+        return secs * 1000 + millis;
+    }
+
+    // Formats as "YYYY-MM-DDTHH:MM:SS.mmm+00:00" (UTC)
+    inline std::string format_timestamp_iso(int64_t ms) {
+        int64_t secs = ms >= 0 ? ms / 1000 : (ms - 999) / 1000;
+        int millis = static_cast<int>(ms - secs * 1000);
+        int64_t days = secs >= 0 ? secs / 86400 : (secs - 86399) / 86400;
+        int64_t sod = secs - days * 86400;
+
+        // civil_from_days
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(days - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+        const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+        const int64_t y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%04lld-%02u-%02uT%02d:%02d:%02d.%03d+00:00",
+                 static_cast<long long>(y), m, d,
+                 static_cast<int>(sod / 3600), static_cast<int>(sod / 60 % 60), static_cast<int>(sod % 60), millis);
+        return buf;
+    }
+
+}
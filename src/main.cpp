@@ -1,5 +1,5 @@
 #include "core/app.hpp"
-#include <iostream>
+#include "core/log.hpp"
 
 int main(int argc, char** argv) {
     try {
@@ -7,11 +7,11 @@ int main(int argc, char** argv) {
         if (app.init("config.json")) {
             app.run();
         } else {
-            std::cerr << "Failed to initialize application. Check config.json." << std::endl;
+            LOG_ERROR("Main", "Failed to initialize application. Check config.json.");
             return 1;
         }
     } catch (const std::exception& e) {
-        std::cerr << "Fatal error: " << e.what() << std::endl;
+        LOG_ERROR("Main", "Fatal error: ", e.what());
         return 1;
     }
     return 0;
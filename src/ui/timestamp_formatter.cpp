@@ -0,0 +1,66 @@
+#include "timestamp_formatter.hpp"
+
+#include <ctime>
+
+namespace discord {
+
+    namespace {
+
+        constexpr size_t MAX_CACHED_LABELS = 4096;
+
+        int64_t floor_div(int64_t a, int64_t b) {
+            return a >= 0 ? a / b : (a - b + 1) / b;
+        }
+
+    }
+
+    void TimestampFormatter::refresh_day() {
+        time_t now = time(nullptr);
+        int64_t minute = floor_div(now, 60);
+        if (minute == m_checked_minute) return;
+        m_checked_minute = minute;
+
+        struct tm local;
+        localtime_r(&now, &local);
+        local.tm_hour = 0;
+        local.tm_min = 0;
+        local.tm_sec = 0;
+        int64_t today_start = mktime(&local);
+
+        if (today_start != m_today_start) {
+            // "Today"/"Yesterday" labels are stale after midnight
+            m_today_start = today_start;
+            m_cache.clear();
+        }
+    }
+
+    void TimestampFormatter::begin_frame() {
+        refresh_day();
+    }
+
+    const char* TimestampFormatter::format(int64_t ms) {
+        if (m_checked_minute < 0) refresh_day();
+
+        int64_t minute = floor_div(ms, 60000);
+        auto it = m_cache.find(minute);
+        if (it != m_cache.end()) return it->second.c_str();
+
+        if (m_cache.size() >= MAX_CACHED_LABELS) m_cache.clear();
+
+        time_t t = static_cast<time_t>(minute * 60);
+        struct tm local;
+        localtime_r(&t, &local);
+
+        char buf[64];
+        if (t >= m_today_start) {
+            strftime(buf, sizeof(buf), "Today at %H:%M", &local);
+        } else if (t >= m_today_start - 86400) {
+            strftime(buf, sizeof(buf), "Yesterday at %H:%M", &local);
+        } else {
+            strftime(buf, sizeof(buf), "%x %H:%M", &local);
+        }
+
+        return m_cache.emplace(minute, buf).first->second.c_str();
+    }
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace discord {
+
+    // Turns epoch-millisecond message timestamps into short local-time labels
+    // ("Today at 14:03", "Yesterday at 09:12", or the locale's date format).
+    // Labels only have minute resolution, so they are cached per minute and
+    // the cache is only dropped when the local date rolls over. The wall
+    // clock is read once per frame, in begin_frame().
+    class TimestampFormatter {
+    public:
+        // Call once per frame before formatting
+        void begin_frame();
+
+        // The returned pointer stays valid until the next call that misses
+        // the cache; callers are expected to use it immediately.
+        const char* format(int64_t ms);
+
+    private:
+        void refresh_day();
+
+        std::unordered_map<int64_t, std::string> m_cache; // minute -> label
+        int64_t m_checked_minute = -1; // Wall-clock minute of the last day check
+        int64_t m_today_start = 0;     // Local midnight, epoch seconds
+    };
+
+}
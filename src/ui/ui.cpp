@@ -1,9 +1,41 @@
 #include "ui.hpp"
 #include "../core/app.hpp"
-#include <iostream>
+#include <clocale>
 
 namespace discord {
 
+    namespace {
+
+        // Shows how much history is cached for a hovered channel entry
+        void history_tooltip(const State& state, Snowflake channel_id) {
+            if (!ImGui::IsItemHovered()) return;
+            auto it = state.messages.find(channel_id);
+            if (it == state.messages.end()) return;
+            ImGui::SetTooltip("%zu/%zu messages cached (%.1f KB)", it->second.size(), it->second.capacity(), it->second.memory_usage() / 1024.0);
+        }
+
+        // Right-aligned on the last item: a red pill with the mention count,
+        // or a dot when there are only unread messages
+        void unread_badge(UnreadTracker::Counts counts) {
+            if (counts.unread == 0 && counts.mentions == 0) return;
+            ImDrawList* draw_list = ImGui::GetWindowDrawList();
+            ImVec2 max = ImGui::GetItemRectMax();
+            float mid_y = (ImGui::GetItemRectMin().y + max.y) / 2;
+            if (counts.mentions > 0) {
+                char text[16];
+                snprintf(text, sizeof(text), counts.mentions > 99 ? "99+" : "%u", counts.mentions);
+                ImVec2 size = ImGui::CalcTextSize(text);
+                ImVec2 a(max.x - size.x - 12.0f, mid_y - size.y / 2 - 1.0f);
+                ImVec2 b(max.x - 4.0f, mid_y + size.y / 2 + 1.0f);
+                draw_list->AddRectFilled(a, b, IM_COL32(237, 66, 69, 255), size.y);
+                draw_list->AddText(ImVec2(a.x + 4.0f, a.y + 1.0f), IM_COL32_WHITE, text);
+            } else {
+                draw_list->AddCircleFilled(ImVec2(max.x - 8.0f, mid_y), 3.0f, IM_COL32_WHITE);
+            }
+        }
+
+    }
+
     UI::UI() : m_window(nullptr) {
         memset(m_input_buffer, 0, sizeof(m_input_buffer));
     }
@@ -19,6 +51,9 @@ namespace discord {
 
         if (!glfwInit()) return false;
 
+        // Message timestamps use the user's date format
+        std::setlocale(LC_TIME, "");
+
         // GL 3.2 + GLSL 150 (Standard for macOS Core Profile)
         const char* glsl_version = "#version 150";
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -28,7 +63,7 @@ namespace discord {
 
         m_window = glfwCreateWindow(1280, 720, "Chudcord", NULL, NULL);
         if (!m_window) {
-            std::cerr << "Failed to create GLFW window" << std::endl;
+            LOG_ERROR("UI", "Failed to create GLFW window");
             return false;
         }
 
@@ -42,6 +77,19 @@ namespace discord {
 
         ImGui::StyleColorsDark();
 
+        // Any window event means the next frame may look different. These are
+        // installed first so the ImGui backend chains to them.
+        glfwSetWindowUserPointer(m_window, this);
+        glfwSetCursorPosCallback(m_window, [](GLFWwindow* w, double, double) { mark_input(w); });
+        glfwSetCursorEnterCallback(m_window, [](GLFWwindow* w, int) { mark_input(w); });
+        glfwSetMouseButtonCallback(m_window, [](GLFWwindow* w, int, int, int) { mark_input(w); });
+        glfwSetScrollCallback(m_window, [](GLFWwindow* w, double, double) { mark_input(w); });
+        glfwSetKeyCallback(m_window, [](GLFWwindow* w, int, int, int, int) { mark_input(w); });
+        glfwSetCharCallback(m_window, [](GLFWwindow* w, unsigned int) { mark_input(w); });
+        glfwSetWindowFocusCallback(m_window, [](GLFWwindow* w, int) { mark_input(w); });
+        glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* w) { mark_input(w); });
+        glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* w, int, int) { mark_input(w); });
+
         ImGui_ImplGlfw_InitForOpenGL(m_window, true);
         ImGui_ImplOpenGL3_Init(glsl_version);
 
@@ -64,14 +112,40 @@ namespace discord {
         return glfwWindowShouldClose(m_window);
     }
 
-    void UI::new_frame() {
+    void UI::poll_events() {
         glfwPollEvents();
+    }
+
+    void UI::wait_events(double timeout_seconds) {
+        glfwWaitEventsTimeout(timeout_seconds);
+    }
+
+    void UI::wake() {
+        glfwPostEmptyEvent();
+    }
+
+    void UI::mark_input(GLFWwindow* window) {
+        if (auto* ui = static_cast<UI*>(glfwGetWindowUserPointer(window))) ui->m_input_seen = true;
+    }
+
+    bool UI::take_input() {
+        bool seen = m_input_seen;
+        m_input_seen = false;
+        return seen;
+    }
+
+    bool UI::is_animating() const {
+        const ImGuiIO& io = ImGui::GetIO();
+        return ImGui::IsAnyItemActive() || io.WantTextInput;
+    }
+
+    void UI::new_frame() {
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
     }
 
-    void UI::update_icon_texture(const std::string& guild_id, unsigned char* data, int width, int height) {
+    void UI::update_icon_texture(Snowflake guild_id, unsigned char* data, int width, int height) {
         GLuint texture;
         glGenTextures(1, &texture);
         glBindTexture(GL_TEXTURE_2D, texture);
@@ -87,7 +161,7 @@ namespace discord {
         m_guild_icons[guild_id] = texture;
     }
 
-    void UI::update_attachment_texture(const std::string& att_id, unsigned char* data, int width, int height) {
+    void UI::update_attachment_texture(Snowflake att_id, unsigned char* data, int width, int height) {
         GLuint texture;
         glGenTextures(1, &texture);
         glBindTexture(GL_TEXTURE_2D, texture);
@@ -97,7 +171,55 @@ namespace discord {
         m_attachments[att_id] = texture;
     }
 
+    void UI::render_search(const State& state) {
+        ImGui::SetNextWindowSize(ImVec2(420, 480), ImGuiCond_FirstUseEver);
+        if (!ImGui::Begin("Search", &m_search_open)) {
+            ImGui::End();
+            return;
+        }
+
+        // Every edit reruns the query; the index answers locally
+        bool changed = false;
+        ImGui::PushItemWidth(-1);
+        changed |= ImGui::InputTextWithHint("##SearchText", "Search messages", m_search_text, IM_ARRAYSIZE(m_search_text));
+        changed |= ImGui::InputTextWithHint("##SearchAuthor", "From user", m_search_author, IM_ARRAYSIZE(m_search_author));
+        ImGui::PopItemWidth();
+        changed |= ImGui::Checkbox("Current channel only", &m_search_this_channel);
+        if (changed && on_search) on_search(m_search_text, m_search_author, m_search_this_channel);
+
+        if (m_search_text[0] || m_search_author[0]) {
+            ImGui::TextDisabled("%zu results (%.2f ms)", state.search_total, state.search_ms);
+        }
+        ImGui::Separator();
+
+        ImGui::BeginChild("SearchResults");
+        for (const auto& r : state.search_results) {
+            ImGui::PushID((void*)(uintptr_t)r.id.value);
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "#%s", r.channel.empty() ? "unknown" : r.channel.c_str());
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.4f, 1.0f), "%s", r.author.c_str());
+            if (r.timestamp) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("[%s]", m_timestamps.format(r.timestamp));
+            }
+            if (!r.guild_id.empty()) {
+                ImGui::SameLine(ImGui::GetWindowWidth() - 60);
+                if (ImGui::SmallButton("Open")) {
+                    if (on_search_result_selected) on_search_result_selected(r.guild_id, r.channel_id);
+                }
+            }
+            if (r.content.empty()) ImGui::TextDisabled("(content no longer cached)");
+            else ImGui::TextWrapped("%s", r.content.c_str());
+            ImGui::Separator();
+            ImGui::PopID();
+        }
+        ImGui::EndChild();
+        ImGui::End();
+    }
+
     void UI::render(const State& state) {
+        m_timestamps.begin_frame();
+
         // Create a full-screen window for the layout
         ImGui::SetNextWindowPos(ImVec2(0, 0));
         ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
@@ -111,10 +233,11 @@ namespace discord {
             ImGui::Text("...");
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("Waiting for guilds...");
         }
-        for (const auto& guild : state.guilds) {
-            std::string label = guild.name.substr(0, 1); // Single initial
+        for (const auto& slot : state.guilds) {
+            const Guild& guild = *slot;
+            std::string label(guild.name.view().substr(0, 1)); // Single initial
             
-            ImGui::PushID(guild.id.c_str());
+            ImGui::PushID((void*)(uintptr_t)guild.id.value);
             
             ImVec2 p = ImGui::GetCursorScreenPos();
             ImDrawList* draw_list = ImGui::GetWindowDrawList();
@@ -128,10 +251,10 @@ namespace discord {
             } else {
                 // No texture yet, check if we should trigger download
                 if (!guild.icon.empty() && on_load_icon) {
-                    on_load_icon(guild.id, guild.icon);
+                    on_load_icon(guild.id, guild.icon.str());
                 }
 
-                size_t hash = std::hash<std::string>{}(guild.id);
+                size_t hash = std::hash<Snowflake>{}(guild.id);
                 ImU32 col = IM_COL32((hash & 0x7F) + 100, ((hash >> 8) & 0x7F) + 100, ((hash >> 16) & 0x7F) + 100, 255);
                 
                 draw_list->AddCircleFilled(center, radius, col);
@@ -140,6 +263,20 @@ namespace discord {
                 draw_list->AddText(ImVec2(center.x - text_size.x/2, center.y - text_size.y/2), IM_COL32_WHITE, label.c_str());
             }
 
+            // Unread pill on the left edge, mention count on the bottom right
+            UnreadTracker::Counts counts = state.unread.guild(guild.id);
+            if (counts.unread > 0 || counts.mentions > 0) {
+                draw_list->AddRectFilled(ImVec2(p.x - 4.0f, center.y - 5.0f), ImVec2(p.x, center.y + 5.0f), IM_COL32_WHITE, 2.0f);
+            }
+            if (counts.mentions > 0) {
+                char text[16];
+                snprintf(text, sizeof(text), counts.mentions > 99 ? "99+" : "%u", counts.mentions);
+                ImVec2 text_size = ImGui::CalcTextSize(text);
+                ImVec2 badge(center.x + radius - 4.0f, center.y + radius - 4.0f);
+                draw_list->AddCircleFilled(badge, std::max(8.0f, text_size.x / 2 + 3.0f), IM_COL32(237, 66, 69, 255));
+                draw_list->AddText(ImVec2(badge.x - text_size.x / 2, badge.y - text_size.y / 2), IM_COL32_WHITE, text);
+            }
+
             if (ImGui::InvisibleButton("##btn", ImVec2(50, 50))) {
                 if (on_guild_selected) on_guild_selected(guild.id);
             }
@@ -158,26 +295,23 @@ namespace discord {
         // --- Middle Panel: Channel List ---
         ImGui::BeginChild("Channels", ImVec2(200, 0), true);
         ImGui::Text("Channels");
+        ImGui::SameLine(ImGui::GetWindowWidth() - 60);
+        if (ImGui::SmallButton("Search")) m_search_open = !m_search_open;
         ImGui::Separator();
         
         if (!state.current_guild_id.empty()) {
-            // Find current guild
-            const Guild* current_guild = nullptr;
-            for (const auto& g : state.guilds) {
-                if (g.id == state.current_guild_id) {
-                    current_guild = &g;
-                    break;
-                }
-            }
+            const Guild* current_guild = state.get_guild(state.current_guild_id);
 
             if (current_guild) {
                 // First, list channels with no category
                 for (const auto& channel : current_guild->channels) {
                     if (channel.type == 0 && channel.parent_id.empty()) {
                         bool is_selected = (state.current_channel_id == channel.id);
-                        if (ImGui::Selectable(("# " + channel.name).c_str(), is_selected)) {
+                        if (ImGui::Selectable(("# " + channel.name.str()).c_str(), is_selected)) {
                             if (on_channel_selected) on_channel_selected(channel.id);
                         }
+                        history_tooltip(state, channel.id);
+                        unread_badge(state.unread.channel(channel.id));
                     }
                 }
 
@@ -191,9 +325,11 @@ namespace discord {
                             if (channel.type == 0 && channel.parent_id == category.id) {
                                 ImGui::Indent(10.0f);
                                 bool is_selected = (state.current_channel_id == channel.id);
-                                if (ImGui::Selectable(("# " + channel.name).c_str(), is_selected)) {
+                                if (ImGui::Selectable(("# " + channel.name.str()).c_str(), is_selected)) {
                                     if (on_channel_selected) on_channel_selected(channel.id);
                                 }
+                                history_tooltip(state, channel.id);
+                                unread_badge(state.unread.channel(channel.id));
                                 ImGui::Unindent(10.0f);
                             }
                         }
@@ -207,6 +343,10 @@ namespace discord {
 
         // --- Right Panel: Chat ---
         ImGui::BeginChild("Chat", ImVec2(0, 0), true);
+
+        ImGui::PushItemWidth(-1);
+        ImGui::InputTextWithHint("##Filter", "Filter this channel", m_filter_text, IM_ARRAYSIZE(m_filter_text));
+        ImGui::PopItemWidth();
         
         // Chat History Area
         float footer_height = state.reply_msg_id.empty() ? 50.0f : 80.0f;
@@ -220,37 +360,37 @@ namespace discord {
             } else {
                 auto it = state.messages.find(state.current_channel_id);
                 if (it != state.messages.end()) {
-                    for (const auto& msg : it->second) {
-                        ImGui::PushID(msg.id.c_str());
+                    const ChannelHistory& history = it->second;
+                    Snowflake guild_id = history.guild_id().empty() ? state.current_guild_id : history.guild_id();
+                    if (!history.empty() && ImGui::SmallButton("Load older messages")) {
+                        if (on_load_older) on_load_older(state.current_channel_id, history.front().id);
+                    }
+                    auto render_message = [&](const MessageView& msg) {
+                        ImGui::PushID((void*)(uintptr_t)msg.id.value);
                         
                         // If this is a reply, show a small context bar
-                        if (msg.message_reference.has_value() && !msg.message_reference->message_id.empty()) {
+                        if (!msg.reply_to.empty()) {
                             // Find the author of the message we are replying to if it's in history
-                            std::string reply_to_author = "someone";
-                            auto it_msg = state.messages.find(state.current_channel_id);
-                            if (it_msg != state.messages.end()) {
-                                for (const auto& m : it_msg->second) {
-                                    if (m.id == msg.message_reference->message_id) {
-                                        reply_to_author = m.author.username;
-                                        break;
-                                    }
-                                }
+                            const char* reply_to_author = "someone";
+                            size_t reply_index = history.find(msg.reply_to);
+                            if (reply_index != ChannelHistory::npos) {
+                                reply_to_author = history.author_at(reply_index)->username.c_str();
                             }
-                            ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "  ^ Replying to @%s", reply_to_author.c_str());
+                            ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "  ^ Replying to @%s", reply_to_author);
                         }
 
-                        ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.4f, 1.0f), "%s", msg.author.username.c_str());
+                        ImGui::TextColored(ImVec4(0.4f, 1.0f, 0.4f, 1.0f), "%s", msg.author->username.c_str());
                         ImGui::SameLine();
-                        ImGui::TextDisabled(" [%s]", msg.timestamp.c_str());
+                        ImGui::TextDisabled(" [%s]", m_timestamps.format(msg.timestamp));
                         
                         // Reply button on right
                         ImGui::SameLine(ImGui::GetWindowWidth() - 70);
                         if (ImGui::SmallButton("Reply")) {
-                            if (on_reply_selected) on_reply_selected(msg.id, msg.author.username, msg.content, msg.guild_id);
+                            if (on_reply_selected) on_reply_selected(msg.id, msg.author->username.str(), std::string(msg.content), guild_id);
                         }
 
                         if (!msg.content.empty()) {
-                            ImGui::TextWrapped("%s", msg.content.c_str());
+                            ImGui::TextWrapped("%s", msg.content.data());
                         }
 
                         // Render Attachments
@@ -263,16 +403,25 @@ namespace discord {
                                     float draw_h = draw_w * aspect;
                                     ImGui::Image((void*)(intptr_t)it_att->second, ImVec2(draw_w, draw_h));
                                 } else {
-                                    if (on_load_attachment) on_load_attachment(att.id, att.url);
-                                    ImGui::TextDisabled("[Loading Image: %s]", att.filename.c_str());
+                                    if (on_load_attachment) on_load_attachment(att.id, std::string(att.url));
+                                    ImGui::TextDisabled("[Loading Image: %s]", att.filename.data());
                                 }
                             } else {
-                                ImGui::TextColored(ImVec4(0.4f, 0.4f, 1.0f, 1.0f), "[Attachment: %s]", att.filename.c_str());
+                                ImGui::TextColored(ImVec4(0.4f, 0.4f, 1.0f, 1.0f), "[Attachment: %s]", att.filename.data());
                             }
                         }
 
                         ImGui::Separator();
                         ImGui::PopID();
+                    };
+
+                    if (m_filter_text[0]) {
+                        // Recomputed only when the text or the history changes
+                        const auto& matches = m_filter.update(history, m_filter_text);
+                        ImGui::TextDisabled("%zu of %zu messages match", matches.size(), history.size());
+                        for (uint32_t i : matches) render_message(history[i]);
+                    } else {
+                        for (const auto& msg : history) render_message(msg);
                     }
                     
                     // Smart auto-scroll logic
@@ -298,7 +447,7 @@ namespace discord {
                 ImGui::TextColored(ImVec4(0.4f, 0.7f, 1.0f, 1.0f), "Replying to: %s", preview.c_str());
                 ImGui::SameLine();
                 if (ImGui::SmallButton("Cancel Reply")) {
-                    if (on_reply_selected) on_reply_selected("", "", "", "");
+                    if (on_reply_selected) on_reply_selected(Snowflake{}, "", "", Snowflake{});
                 }
             }
             if (!state.attached_file_path.empty()) {
@@ -339,6 +488,8 @@ namespace discord {
         ImGui::End(); // Main
         ImGui::PopStyleVar();
 
+        if (m_search_open) render_search(state);
+
         ImGui::Render();
         int display_w, display_h;
         glfwGetFramebufferSize(m_window, &display_w, &display_h);
@@ -9,6 +9,9 @@
 #include <GLFW/glfw3.h>
 
 #include <unordered_map>
+#include "../discord/snowflake.hpp"
+#include "timestamp_formatter.hpp"
+#include "../core/substring_search.hpp"
 
 namespace discord {
 
@@ -25,30 +28,60 @@ namespace discord {
         bool should_close();
         void new_frame();
         void render(const State& state);
+
+        // Event pumping. wait_events sleeps until input arrives, wake() is
+        // called or the timeout expires; poll_events never blocks.
+        void poll_events();
+        void wait_events(double timeout_seconds);
+        static void wake(); // Safe from any thread
+
+        // True if window input arrived since the last call
+        bool take_input();
+        // True while ImGui needs frames without new input (text cursor blink, drags)
+        bool is_animating() const;
         
         // Input handling
-        std::function<void(const std::string&, const std::string&, const std::string&)> on_send_message; // content, reply_id, file_path
-        std::function<void(const std::string&)> on_channel_selected;
-        std::function<void(const std::string&)> on_guild_selected;
-        std::function<void(const std::string&, const std::string&)> on_load_icon;
-        std::function<void(const std::string&, const std::string&, const std::string&, const std::string&)> on_reply_selected; // msg_id, username, content, guild_id
-        std::function<void(const std::string&, const std::string&)> on_load_attachment; // att_id, url
+        std::function<void(const std::string&, Snowflake, const std::string&)> on_send_message; // content, reply_id, file_path
+        std::function<void(Snowflake)> on_channel_selected;
+        std::function<void(Snowflake)> on_guild_selected;
+        std::function<void(Snowflake, const std::string&)> on_load_icon;
+        std::function<void(Snowflake, const std::string&, const std::string&, Snowflake)> on_reply_selected; // msg_id, username, content, guild_id
+        std::function<void(Snowflake, const std::string&)> on_load_attachment; // att_id, url
         std::function<void()> on_file_picker_requested;
         std::function<void()> on_clear_attachment;
+        std::function<void(Snowflake, Snowflake)> on_load_older; // channel_id, oldest loaded message_id
+        std::function<void(const std::string&, const std::string&, bool)> on_search; // text, author, current channel only
+        std::function<void(Snowflake, Snowflake)> on_search_result_selected; // guild_id, channel_id
 
         // Texture management (call from main thread)
-        void update_icon_texture(const std::string& guild_id, unsigned char* data, int width, int height);
-        void update_attachment_texture(const std::string& attachment_id, unsigned char* data, int width, int height);
+        void update_icon_texture(Snowflake guild_id, unsigned char* data, int width, int height);
+        void update_attachment_texture(Snowflake attachment_id, unsigned char* data, int width, int height);
         void clear_reply(); // Helper for UI to clear reply state locally if needed
 
     private:
+        static void mark_input(GLFWwindow* window);
+        void render_search(const State& state);
+
         GLFWwindow* m_window;
+        bool m_input_seen{true}; // Set by GLFW callbacks, cleared by take_input()
         char m_input_buffer[1024];
         bool m_scroll_to_bottom{false};
-        std::string m_last_channel_id;
+        Snowflake m_last_channel_id;
+
+        // Chat filter box
+        char m_filter_text[128]{};
+        HistoryFilter m_filter;
+
+        // Search window
+        bool m_search_open{false};
+        char m_search_text[256]{};
+        char m_search_author[64]{};
+        bool m_search_this_channel{false};
+
+        std::unordered_map<Snowflake, unsigned int> m_guild_icons;
+        std::unordered_map<Snowflake, unsigned int> m_attachments;
 
-        std::unordered_map<std::string, unsigned int> m_guild_icons;
-        std::unordered_map<std::string, unsigned int> m_attachments;
+        TimestampFormatter m_timestamps;
     };
 
 }